@@ -1,13 +1,31 @@
-__kernel void adjacent_difference(__global float* vec_in, __global float* vec_out)
+// Element type can be chosen at build time, e.g. program.build("-DDATA_TYPE=int")
+#ifndef DATA_TYPE
+#define DATA_TYPE float
+#endif
+
+__kernel void adjacent_difference(__global DATA_TYPE* vec_in, __global DATA_TYPE* vec_out)
 {
     int gid = get_global_id(0);
-    
+
     // First element of the vec_out is the first element of the vec_in
     if (gid == 0)
         vec_out[0] = vec_in[0];
 
     // Then every element is the pair-wise difference of indices (gid, gid-1)
-    else 
+    else
         vec_out[gid] = vec_in[gid] - vec_in[gid-1];
 
-}
\ No newline at end of file
+}
+
+// Streaming variant: vec_in[0] is the halo (the last element of the previous chunk), the chunk itself starts at vec_in[1]
+__kernel void adjacent_difference_halo(__global DATA_TYPE* vec_in, __global DATA_TYPE* vec_out, int first_chunk)
+{
+    int gid = get_global_id(0);
+
+    // The very first chunk has no halo, its first element is copied as is
+    if (first_chunk && gid == 0)
+        vec_out[0] = vec_in[1];
+
+    else
+        vec_out[gid] = vec_in[gid + 1] - vec_in[gid];
+}
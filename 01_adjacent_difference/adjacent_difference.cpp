@@ -6,9 +6,74 @@
 #include <random>            // std::default_random_engine, std::uniform_real_distribution
 #include <cstdlib>           // EXIT_FAILURE
 #include <chrono>            // std::chrono::high_resolution_clock::now()
-#include <numeric>           // std::adjacent_difference
+#include <numeric>           // std::adjacent_difference, std::partial_sum
+#include <string>            // std::string
+#include <algorithm>         // std::generate_n, std::equal, std::min
 
-int main()
+#include <sys/mman.h>        // mmap, munmap, msync, madvise
+#include <sys/stat.h>        // fstat
+#include <fcntl.h>           // open
+#include <unistd.h>          // close, ftruncate
+
+#include "benchmark.hpp"     // measure_peak_bandwidth(), benchmark_point, finish_benchmark(), power_of_two_work_group_size()
+#include "zero_copy.hpp"     // host_vector, create_input_buffer(), create_output_buffer(), fetch_buffer()
+
+// Number of 4 wide vectors a work item of the tiled kernel handles
+constexpr int coarsen = 4;
+
+// Default number of elements per chunk in streaming mode
+constexpr size_t default_chunk_size = 1 << 24;
+
+// Number of chunks in flight in streaming mode: one being uploaded, one computed, one downloaded
+constexpr int n_stream_slots = 3;
+
+// Scratch buffers of the three pass scan: the tile sums and their exclusive scan for every level of the recursion
+struct scan_scratch
+{
+    std::vector<cl::Buffer> group_sums;
+    std::vector<cl::Buffer> scanned_group_sums;
+};
+
+// Scratch buffers of the decoupled look-back scan: the packed status and value of every tile, and the tile counter
+struct lookback_scratch
+{
+    cl::Buffer tile_state;
+    cl::Buffer tile_counter;
+};
+
+// Allocate the scratch buffers once for a given problem and work group size, so the scans themselves only launch kernels
+scan_scratch create_scan_scratch(cl::Context context, cl_uint n, size_t elementSize, size_t workGroupSize);
+lookback_scratch create_lookback_scratch(cl::Context context, cl_uint n, size_t workGroupSize);
+
+// The look-back publishes the state of a tile with 64 bit atomics, without them only the three pass scan is available
+bool lookback_scan_available(cl::Device device);
+
+// Work-efficient scan in three passes: scan every workgroup's tile, scan the tile sums (recursively), add them back
+void scan_via_gpu(cl::CommandQueue queue, cl::Kernel kernel_scan, cl::Kernel kernel_add, cl::Buffer buf_in, cl::Buffer buf_out,
+                  cl_uint n, size_t elementSize, size_t workGroupSize, bool inclusive, const scan_scratch& scratch, size_t level = 0);
+
+// Single pass scan, tiles get the sum of the previous tiles with decoupled look-back
+void scan_decoupled_lookback_via_gpu(cl::CommandQueue queue, cl::Kernel kernel, cl::Buffer buf_in, cl::Buffer buf_out,
+                                     cl_uint n, size_t elementSize, size_t workGroupSize, bool inclusive, const lookback_scratch& scratch);
+
+// Run the tiled kernel built for the given element type, compare with std::adjacent_difference and report the bandwidth
+template <typename T>
+bool run_tiled_adjacent_difference(cl::Context context, cl::CommandQueue queue, cl::Device device, const std::string& source_tiled,
+                                   const std::string& type_name, const host_vector<T>& vec_in, double peak_bandwidth);
+
+// Streaming mode: adjacent_difference of a memory-mapped file of floats into another one, chunk by chunk,
+// with upload, compute and download of different chunks overlapped on 3 command queues
+void stream_adjacent_difference_via_gpu(cl::Context context, cl::Device device, cl::Program program,
+                                        const std::string& input_path, const std::string& output_path, size_t chunkSize);
+
+// Write N random floats into a file, input for the streaming mode
+void generate_input_file(const std::string& path, size_t N);
+
+// Benchmark mode: sweep problem sizes and work group sizes of every kernel, then print a roofline style summary
+void benchmark_adjacent_difference(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program,
+                                   const std::string& source_tiled, const std::string& source_scan);
+
+int main(int argc, char* argv[])
 {
     std::cout << "main() started" << std::endl;
     try
@@ -19,22 +84,56 @@ int main()
         cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
         cl::Platform platform{device.getInfo<CL_DEVICE_PLATFORM>()};
 
-        // Load adjacent_different.cl kernel source file
+        // Load adjacent_different.cl, adjacent_difference_tiled.cl and scan.cl kernel source files
         std::ifstream source_file{ "../adjacent_difference.cl" };
+        std::ifstream source_file_tiled{ "../adjacent_difference_tiled.cl" };
+        std::ifstream source_file_scan{ "../scan.cl" };
         if (!source_file.is_open())
             throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + "adjacent_difference.cl" };
+        if (!source_file_tiled.is_open())
+            throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + "adjacent_difference_tiled.cl" };
+        if (!source_file_scan.is_open())
+            throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + "scan.cl" };
+
+        std::string source{ std::istreambuf_iterator<char>{ source_file }, std::istreambuf_iterator<char>{} };
+        std::string source_tiled{ std::istreambuf_iterator<char>{ source_file_tiled }, std::istreambuf_iterator<char>{} };
+        std::string source_scan{ std::istreambuf_iterator<char>{ source_file_scan }, std::istreambuf_iterator<char>{} };
 
         // Create cl::Program from kernel and build it for the device
-        cl::Program program{ std::string{ std::istreambuf_iterator<char>{ source_file },
-                                          std::istreambuf_iterator<char>{} } };
+        cl::Program program{ source };
         program.build({ device });
 
+        // Modes working on files instead of the in-memory test below
+        std::string mode = argc > 1 ? argv[1] : "";
+        size_t chunkSize = (mode == "--stream" && argc == 5) ? std::stoull(argv[4]) : default_chunk_size;
+        if (mode == "--generate" && argc == 4)
+        {
+            generate_input_file(argv[2], std::stoull(argv[3]));
+            return 0;
+        }
+        else if (mode == "--stream" && (argc == 4 || argc == 5) && chunkSize > 0)
+        {
+            stream_adjacent_difference_via_gpu(context, device, program, argv[2], argv[3], chunkSize);
+            return 0;
+        }
+        else if (mode == "--benchmark" && argc == 2)
+        {
+            benchmark_adjacent_difference(context, queue, device, program, source_tiled, source_scan);
+            return 0;
+        }
+        else if (!mode.empty())
+        {
+            std::cerr << "Usage: " << argv[0] << " [--generate <file> <N> | --stream <input file> <output file> [chunk size] | --benchmark]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
         // My adjacent_difference function takes 2 args, that's why we put 2 cl::Buffers here
         auto adjacent_difference = cl::KernelFunctor<cl::Buffer, cl::Buffer>(program, "adjacent_difference");
 
         // Initialize computation
         constexpr cl::size_type N = 10000000; 
-        std::vector<cl_float> vec_in(N), vec_out(N), vec_CPU_test(N);
+        host_vector<cl_float> vec_in(N), vec_out(N);
+        std::vector<cl_float> vec_CPU_test(N);
 
         // Fill vec_in with random values between 0 and 100 (just to use this lovely random number generator)
         auto prng = [engine = std::default_random_engine{},
@@ -42,13 +141,16 @@ int main()
 
         std::generate_n(std::begin(vec_in), N, prng);
 
-        // Create buffers: we only want to read the vec_in, and we want to write the vec_out
-        cl::Buffer buf_in{ std::begin(vec_in), std::end(vec_in), true };     
-        cl::Buffer buf_out{ std::begin(vec_out), std::end(vec_out), false }; 
+        // If the device shares memory with the host, the buffers use vec_in and vec_out directly instead of copies
+        bool zero_copy = zero_copy_available(device);
+        std::cout << (zero_copy ? "Zero-copy mode: device shares memory with the host." : "Copy mode: device has its own memory.") << std::endl;
 
-        // Dispatch of data before launch, a.k.a. copy the vec_in and vec_out into the cl::Buffers buf_in and buf_out
-        cl::copy(queue, std::begin(vec_in), std::end(vec_in), buf_in);
-        cl::copy(queue, std::begin(vec_out), std::end(vec_out), buf_out);
+        // Create buffers: we only want to read the vec_in, and we want to write the vec_out
+        // Dispatch of data before launch, a.k.a. copy the vec_in into buf_in (or just hand it over in zero-copy mode)
+        auto t0_dispatch = std::chrono::high_resolution_clock::now();
+        cl::Buffer buf_in = create_input_buffer(queue, context, CL_MEM_READ_ONLY, vec_in, zero_copy);
+        cl::Buffer buf_out = create_output_buffer(context, CL_MEM_WRITE_ONLY, vec_out, zero_copy);
+        auto t1_dispatch = std::chrono::high_resolution_clock::now();
 
         // Launch adjacent_different calculator kernel and measure the computation time
         auto t0 = std::chrono::high_resolution_clock::now(); // Record start time
@@ -63,10 +165,18 @@ int main()
         //Elapsed time while computing on GPU
         auto dt = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
 
-        // Fetch of results, a.k.a. copy the results from buf_out to vec_out
-        cl::copy(queue, buf_out, std::begin(vec_out), std::end(vec_out));
+        // Fetch of results, a.k.a. copy the results from buf_out to vec_out (or map it in zero-copy mode, until results goes out of scope)
+        auto t0_fetch = std::chrono::high_resolution_clock::now();
+        auto results = fetch_buffer(queue, buf_out, vec_out, zero_copy);
+        auto t1_fetch = std::chrono::high_resolution_clock::now();
+
+        auto dt_transfer = std::chrono::duration_cast<std::chrono::microseconds>((t1_dispatch - t0_dispatch) + (t1_fetch - t0_fetch)).count();
 
         std::cout << "Elapsed computation time on GPU for N = "<< N << " long float vector: " << dt << " ms." << std::endl;
+        std::cout << "Elapsed dispatch + fetch time for N = " << N << " long float vector: " << dt_transfer << " us." << std::endl;
+
+        // How much time zero-copy saves on transfers of this size
+        benchmark_zero_copy_transfers(context, queue, sizeof(cl_float) * N);
 
         // CPU computation time comparison 
         auto t0_CPU = std::chrono::high_resolution_clock::now();
@@ -76,13 +186,125 @@ int main()
         std::cout << "Elapsed computation time on CPU for N = "<< N << " long float vector: " << dt_CPU << " ms." << std::endl;
 
         // Check if my adjacent_difference calculator provides the same result as std::adjacent_difference
-        if (std::equal(vec_out.begin(), vec_out.end(), vec_CPU_test.begin()))
+        if (std::equal(results.begin(), results.end(), vec_CPU_test.begin()))
             std::cout << "My adjacent_difference kernel provided the same results as we can get with std::adjacent_difference()." << std::endl;
         else
             std::cout << "The results of my adjacent_difference kernel and the results of std::adjacent_difference are not the same." << std::endl;
-        
-        
 
+        // Measure the peak bandwidth of the device, kernels are reported as a fraction of it
+        // (every element has to be read once and written once, that is the traffic we count)
+        double peak_bandwidth = measure_peak_bandwidth(context, queue, device);
+        double bandwidth = dt > 0 ? 2.0 * sizeof(cl_float) * N / (dt * 1e-6) / 1e9 : 0.0;
+        std::cout << "Measured peak bandwidth (stream copy): " << peak_bandwidth << " GB/s." << std::endl;
+        std::cout << "adjacent_difference (float): " << bandwidth << " GB/s = " << 100.0 * bandwidth / peak_bandwidth << " % of peak." << std::endl;
+
+        // Tiled, coarsened and vectorized kernel for float, int and (if the device supports it) double elements
+        host_vector<cl_int> vec_in_int(N);
+        host_vector<cl_double> vec_in_double(N);
+        auto prng_int_tiled = [engine = std::default_random_engine{},
+                               distribution = std::uniform_int_distribution<cl_int>{ -1000000, 1000000 }]() mutable { return distribution(engine); };
+        auto prng_double = [engine = std::default_random_engine{},
+                            distribution = std::uniform_real_distribution<cl_double>{ 0.0, 100.0 }]() mutable { return distribution(engine); };
+        std::generate_n(std::begin(vec_in_int), N, prng_int_tiled);
+        std::generate_n(std::begin(vec_in_double), N, prng_double);
+
+        run_tiled_adjacent_difference(context, queue, device, source_tiled, "float", vec_in, peak_bandwidth);
+        run_tiled_adjacent_difference(context, queue, device, source_tiled, "int", vec_in_int, peak_bandwidth);
+        if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos)
+            run_tiled_adjacent_difference(context, queue, device, source_tiled, "double", vec_in_double, peak_bandwidth);
+        else
+            std::cout << "Device does not support double, skipping the tiled double kernel." << std::endl;
+
+        // Round-trip test: scan(adjacent_difference(x)) == x
+        // Done on integers, so the scan does not suffer from rounding and the check can be exact
+        cl::Program program_int{ source };
+        cl::Program program_scan_int{ source_scan };
+        program_int.build({ device }, "-DDATA_TYPE=int");
+        program_scan_int.build({ device }, "-DDATA_TYPE=int");
+
+        auto adjacent_difference_int = cl::KernelFunctor<cl::Buffer, cl::Buffer>(program_int, "adjacent_difference");
+        cl::Kernel kernel_scan(program_scan_int, "scan_workgroup");
+        cl::Kernel kernel_add(program_scan_int, "add_group_sums");
+
+        // Work group sizes must be powers of two for the tiles of the scan
+        size_t workGroupSize = power_of_two_work_group_size(std::min(kernel_scan.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device),
+                                                                     kernel_add.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device)));
+
+        // Values between 0 and 100, so even the full prefix sum fits into an int
+        std::vector<cl_int> x(N), x_scanned(N), x_lookback(N), x_exclusive(N), x_CPU_scanned(N), x_CPU_diff(N);
+        auto prng_int = [engine = std::default_random_engine{},
+                         distribution = std::uniform_int_distribution<cl_int>{ 0, 100 }]() mutable { return distribution(engine); };
+        std::generate_n(std::begin(x), N, prng_int);
+
+        cl::Buffer buf_x{ context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_int) * N, x.data() };
+        cl::Buffer buf_diff{ context, CL_MEM_READ_WRITE, sizeof(cl_int) * N };
+        cl::Buffer buf_scanned{ context, CL_MEM_READ_WRITE, sizeof(cl_int) * N };
+        scan_scratch scratch = create_scan_scratch(context, N, sizeof(cl_int), workGroupSize);
+
+        adjacent_difference_int(cl::EnqueueArgs{ queue, cl::NDRange{ N } }, buf_x, buf_diff);
+        cl::finish();
+
+        // Three pass scan
+        auto t0_scan = std::chrono::high_resolution_clock::now();
+        scan_via_gpu(queue, kernel_scan, kernel_add, buf_diff, buf_scanned, N, sizeof(cl_int), workGroupSize, true, scratch);
+        cl::finish();
+        auto t1_scan = std::chrono::high_resolution_clock::now();
+        auto dt_scan = std::chrono::duration_cast<std::chrono::microseconds>(t1_scan - t0_scan).count();
+        cl::copy(queue, buf_scanned, std::begin(x_scanned), std::end(x_scanned));
+
+        // Single pass scan with decoupled look-back, if the device has the 64 bit atomics it needs
+        bool lookback = lookback_scan_available(device);
+        long long dt_lookback = 0;
+        if (lookback)
+        {
+            cl::Kernel kernel_lookback(program_scan_int, "scan_decoupled_lookback");
+            size_t workGroupSize_lookback = power_of_two_work_group_size(kernel_lookback.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+            lookback_scratch scratch_lookback = create_lookback_scratch(context, N, workGroupSize_lookback);
+
+            auto t0_lookback = std::chrono::high_resolution_clock::now();
+            scan_decoupled_lookback_via_gpu(queue, kernel_lookback, buf_diff, buf_scanned, N, sizeof(cl_int), workGroupSize_lookback, true, scratch_lookback);
+            cl::finish();
+            auto t1_lookback = std::chrono::high_resolution_clock::now();
+            dt_lookback = std::chrono::duration_cast<std::chrono::microseconds>(t1_lookback - t0_lookback).count();
+            cl::copy(queue, buf_scanned, std::begin(x_lookback), std::end(x_lookback));
+        }
+
+        // Exclusive scan of the differences is x shifted by one, starting with 0
+        scan_via_gpu(queue, kernel_scan, kernel_add, buf_diff, buf_scanned, N, sizeof(cl_int), workGroupSize, false, scratch);
+        cl::finish();
+        cl::copy(queue, buf_scanned, std::begin(x_exclusive), std::end(x_exclusive));
+
+        // CPU computation time comparison
+        auto t0_CPU_scan = std::chrono::high_resolution_clock::now();
+        std::adjacent_difference(x.begin(), x.end(), x_CPU_diff.begin());
+        std::partial_sum(x_CPU_diff.begin(), x_CPU_diff.end(), x_CPU_scanned.begin());
+        auto t1_CPU_scan = std::chrono::high_resolution_clock::now();
+        auto dt_CPU_scan = std::chrono::duration_cast<std::chrono::microseconds>(t1_CPU_scan - t0_CPU_scan).count();
+
+        std::cout << "Elapsed scan time on GPU (3 pass) for N = " << N << " long int vector: " << dt_scan << " us." << std::endl;
+        if (lookback)
+            std::cout << "Elapsed scan time on GPU (decoupled look-back) for N = " << N << " long int vector: " << dt_lookback << " us." << std::endl;
+        else
+            std::cout << "Device does not support cl_khr_int64_base_atomics, skipping the decoupled look-back scan." << std::endl;
+        std::cout << "Elapsed adjacent_difference + partial_sum time on CPU for N = " << N << " long int vector: " << dt_CPU_scan << " us." << std::endl;
+
+        if (std::equal(x_scanned.begin(), x_scanned.end(), x.begin()))
+            std::cout << "Round-trip OK: 3 pass scan(adjacent_difference(x)) == x." << std::endl;
+        else
+            std::cout << "Round-trip WRONG: 3 pass scan(adjacent_difference(x)) != x." << std::endl;
+
+        if (lookback)
+        {
+            if (std::equal(x_lookback.begin(), x_lookback.end(), x.begin()))
+                std::cout << "Round-trip OK: decoupled look-back scan(adjacent_difference(x)) == x." << std::endl;
+            else
+                std::cout << "Round-trip WRONG: decoupled look-back scan(adjacent_difference(x)) != x." << std::endl;
+        }
+
+        if (x_exclusive[0] == 0 && std::equal(x_exclusive.begin() + 1, x_exclusive.end(), x.begin()))
+            std::cout << "Exclusive scan OK: exclusive_scan(adjacent_difference(x)) == (0, x[0], ..., x[N-2])." << std::endl;
+        else
+            std::cout << "Exclusive scan WRONG." << std::endl;
     }
     catch (cl::BuildError& error) // If kernel failed to build
     {
@@ -111,3 +333,404 @@ int main()
         std::exit(EXIT_FAILURE);
     }
 }
+
+scan_scratch create_scan_scratch(cl::Context context, cl_uint n, size_t elementSize, size_t workGroupSize)
+{
+    // Every work item handles 2 elements of the tile, every level of the recursion scans the tile sums of the one before
+    size_t tileSize = 2 * workGroupSize;
+    size_t n_groups = (n + tileSize - 1) / tileSize;
+
+    scan_scratch scratch;
+    scratch.group_sums.emplace_back(context, CL_MEM_READ_WRITE, elementSize * n_groups);
+    while (n_groups > 1)
+    {
+        scratch.scanned_group_sums.emplace_back(context, CL_MEM_READ_WRITE, elementSize * n_groups);
+        n_groups = (n_groups + tileSize - 1) / tileSize;
+        scratch.group_sums.emplace_back(context, CL_MEM_READ_WRITE, elementSize * n_groups);
+    }
+    return scratch;
+}
+
+lookback_scratch create_lookback_scratch(cl::Context context, cl_uint n, size_t workGroupSize)
+{
+    // Every work item handles 2 elements of the tile, the state of a tile is one 64 bit word
+    size_t tileSize = 2 * workGroupSize;
+    size_t n_groups = (n + tileSize - 1) / tileSize;
+
+    return lookback_scratch{ cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_ulong) * n_groups),
+                             cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_int)) };
+}
+
+bool lookback_scan_available(cl::Device device)
+{
+    return device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_int64_base_atomics") != std::string::npos;
+}
+
+void scan_via_gpu(cl::CommandQueue queue, cl::Kernel kernel_scan, cl::Kernel kernel_add, cl::Buffer buf_in, cl::Buffer buf_out,
+                  cl_uint n, size_t elementSize, size_t workGroupSize, bool inclusive, const scan_scratch& scratch, size_t level)
+{
+    // Every work item handles 2 elements of the tile
+    size_t tileSize = 2 * workGroupSize;
+    size_t n_groups = (n + tileSize - 1) / tileSize;
+
+    // Scan every tile on its own
+    kernel_scan.setArg(0, buf_in);                          //__global const DATA_TYPE* vec_in
+    kernel_scan.setArg(1, buf_out);                         //__global DATA_TYPE* vec_out
+    kernel_scan.setArg(2, scratch.group_sums[level]);       //__global DATA_TYPE* group_sums
+    kernel_scan.setArg(3, elementSize * tileSize, nullptr); //__local DATA_TYPE* tile
+    kernel_scan.setArg(4, n);                               // uint n
+    kernel_scan.setArg(5, inclusive ? 1 : 0);               // int inclusive
+    queue.enqueueNDRangeKernel(kernel_scan, cl::NullRange, cl::NDRange(n_groups * workGroupSize), cl::NDRange(workGroupSize));
+
+    // A single tile is already done
+    if (n_groups == 1)
+        return;
+
+    // Exclusive scan of the tile sums gives the sum of every tile before a given tile
+    scan_via_gpu(queue, kernel_scan, kernel_add, scratch.group_sums[level], scratch.scanned_group_sums[level],
+                 static_cast<cl_uint>(n_groups), elementSize, workGroupSize, false, scratch, level + 1);
+
+    // Add them back uniformly to the tiles
+    kernel_add.setArg(0, buf_out);                             //__global DATA_TYPE* vec_out
+    kernel_add.setArg(1, scratch.scanned_group_sums[level]);   //__global const DATA_TYPE* scanned_group_sums
+    kernel_add.setArg(2, n);                                   // uint n
+    queue.enqueueNDRangeKernel(kernel_add, cl::NullRange, cl::NDRange(n_groups * workGroupSize), cl::NDRange(workGroupSize));
+}
+
+void scan_decoupled_lookback_via_gpu(cl::CommandQueue queue, cl::Kernel kernel, cl::Buffer buf_in, cl::Buffer buf_out,
+                                     cl_uint n, size_t elementSize, size_t workGroupSize, bool inclusive, const lookback_scratch& scratch)
+{
+    // Every work item handles 2 elements of the tile
+    size_t tileSize = 2 * workGroupSize;
+    size_t n_groups = (n + tileSize - 1) / tileSize;
+
+    // Tile states (STATUS_NOT_READY) and the tile counter have to start from zero on every launch
+    queue.enqueueFillBuffer(scratch.tile_state, cl_ulong{ 0 }, 0, sizeof(cl_ulong) * n_groups);
+    queue.enqueueFillBuffer(scratch.tile_counter, cl_int{ 0 }, 0, sizeof(cl_int));
+
+    kernel.setArg(0, buf_in);                          //__global const DATA_TYPE* vec_in
+    kernel.setArg(1, buf_out);                         //__global DATA_TYPE* vec_out
+    kernel.setArg(2, scratch.tile_state);              //__global volatile ulong* tile_state
+    kernel.setArg(3, scratch.tile_counter);            //__global volatile int* tile_counter
+    kernel.setArg(4, elementSize * tileSize, nullptr); //__local DATA_TYPE* tile
+    kernel.setArg(5, n);                               // uint n
+    kernel.setArg(6, inclusive ? 1 : 0);               // int inclusive
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n_groups * workGroupSize), cl::NDRange(workGroupSize));
+}
+
+template <typename T>
+bool run_tiled_adjacent_difference(cl::Context context, cl::CommandQueue queue, cl::Device device, const std::string& source_tiled,
+                                   const std::string& type_name, const host_vector<T>& vec_in, double peak_bandwidth)
+{
+    // Build the tiled kernel for the element type
+    std::string options = "-DDATA_TYPE=" + type_name + " -DCOARSEN=" + std::to_string(coarsen);
+    cl::Program program{ source_tiled };
+    program.build({ device }, options.c_str());
+    cl::Kernel kernel(program, "adjacent_difference_tiled");
+
+    // Tile (plus the halo element) has to fit into local memory
+    size_t workGroupSize = std::min<size_t>(256, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+    while (workGroupSize > 1 && (workGroupSize * coarsen * 4 + 1) * sizeof(T) > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+        workGroupSize /= 2;
+    size_t tileSize = workGroupSize * coarsen * 4;
+
+    size_t n = vec_in.size();
+    size_t n_groups = (n + tileSize - 1) / tileSize;
+    std::vector<T> vec_out(n), vec_CPU_test(n);
+
+    // Blocking upload (or zero-copy), so the transfer is not counted as kernel time
+    cl::Buffer buf_in = create_input_buffer(queue, context, CL_MEM_READ_ONLY, vec_in, zero_copy_available(device));
+    cl::Buffer buf_out{ context, CL_MEM_WRITE_ONLY, sizeof(T) * n };
+
+    kernel.setArg(0, buf_in);                               //__global const DATA_TYPE* vec_in
+    kernel.setArg(1, buf_out);                              //__global DATA_TYPE* vec_out
+    kernel.setArg(2, sizeof(T) * (tileSize + 1), nullptr);  //__local DATA_TYPE* tile
+    kernel.setArg(3, static_cast<cl_uint>(n));              // uint n
+
+    // Launch the kernel and measure the computation time: best of a few launches after a warm up one, like the peak bandwidth
+    double seconds = time_kernel(queue, kernel, cl::NDRange(n_groups * workGroupSize), cl::NDRange(workGroupSize));
+    auto dt = static_cast<long long>(seconds * 1e6);
+
+    cl::copy(queue, buf_out, std::begin(vec_out), std::end(vec_out));
+    std::adjacent_difference(vec_in.begin(), vec_in.end(), vec_CPU_test.begin());
+
+    double bandwidth = seconds > 0.0 ? 2.0 * sizeof(T) * n / seconds / 1e9 : 0.0;
+    std::cout << "Elapsed computation time of tiled adjacent_difference (" << type_name << ") for N = " << n << ": " << dt << " us, "
+              << bandwidth << " GB/s = " << 100.0 * bandwidth / peak_bandwidth << " % of peak." << std::endl;
+
+    bool same = std::equal(vec_out.begin(), vec_out.end(), vec_CPU_test.begin());
+    if (same)
+        std::cout << "Tiled adjacent_difference (" << type_name << ") provided the same results as std::adjacent_difference()." << std::endl;
+    else
+        std::cout << "Tiled adjacent_difference (" << type_name << ") and std::adjacent_difference are not the same." << std::endl;
+
+    return same;
+}
+
+void stream_adjacent_difference_via_gpu(cl::Context context, cl::Device device, cl::Program program,
+                                        const std::string& input_path, const std::string& output_path, size_t chunkSize)
+{
+    // File descriptors and mappings are released on every way out of the function, errors included
+    struct file_descriptor
+    {
+        int fd = -1;
+        ~file_descriptor() { if (fd >= 0) close(fd); }
+    };
+    struct file_mapping
+    {
+        void* address = MAP_FAILED;
+        size_t bytes = 0;
+        ~file_mapping() { if (address != MAP_FAILED) munmap(address, bytes); }
+    };
+
+    // Map the input file
+    file_descriptor fd_in;
+    fd_in.fd = open(input_path.c_str(), O_RDONLY);
+    if (fd_in.fd < 0)
+        throw std::runtime_error{ "Cannot open input file: " + input_path };
+
+    struct stat input_stat;
+    if (fstat(fd_in.fd, &input_stat) != 0)
+        throw std::runtime_error{ "Cannot get the size of input file: " + input_path };
+    if (input_stat.st_size % sizeof(cl_float) != 0)
+        throw std::runtime_error{ "Input file size is not a multiple of sizeof(float): " + input_path };
+
+    size_t N = input_stat.st_size / sizeof(cl_float);
+    size_t bytes = N * sizeof(cl_float);
+    if (N == 0)
+        throw std::runtime_error{ "Input file holds no floats: " + input_path };
+
+    file_mapping input_map;
+    input_map.address = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_in.fd, 0);
+    input_map.bytes = bytes;
+    if (input_map.address == MAP_FAILED)
+        throw std::runtime_error{ "Cannot map input file: " + input_path };
+    madvise(input_map.address, bytes, MADV_SEQUENTIAL);
+
+    // Create and map the output file with the same size
+    file_descriptor fd_out;
+    fd_out.fd = open(output_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_out.fd < 0 || ftruncate(fd_out.fd, bytes) != 0)
+        throw std::runtime_error{ "Cannot create output file: " + output_path };
+
+    file_mapping output_map;
+    output_map.address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_out.fd, 0);
+    output_map.bytes = bytes;
+    if (output_map.address == MAP_FAILED)
+        throw std::runtime_error{ "Cannot map output file: " + output_path };
+
+    const cl_float* input = static_cast<const cl_float*>(input_map.address);
+    cl_float* output = static_cast<cl_float*>(output_map.address);
+
+    // Separate in-order queues for upload, compute and download, so the 3 can run at the same time
+    cl::CommandQueue upload_queue(context, device);
+    cl::CommandQueue compute_queue(context, device);
+    cl::CommandQueue download_queue(context, device);
+
+    cl::Kernel kernel(program, "adjacent_difference_halo");
+
+    // Every slot holds one chunk in flight, input buffers have one extra element in front for the halo
+    chunkSize = std::min(chunkSize, N);
+    std::vector<cl::Buffer> bufs_in(n_stream_slots), bufs_out(n_stream_slots);
+    for (int slot = 0; slot < n_stream_slots; ++slot)
+    {
+        bufs_in[slot] = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, sizeof(cl_float) * (chunkSize + 1));
+        bufs_out[slot] = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, sizeof(cl_float) * chunkSize);
+    }
+
+    // Last events of every slot, a slot can only be reused once its previous chunk is done with the buffers
+    std::vector<cl::Event> kernel_done(n_stream_slots), download_done(n_stream_slots);
+    std::vector<bool> slot_used(n_stream_slots, false);
+
+    size_t n_chunks = (N + chunkSize - 1) / chunkSize;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    try
+    {
+        for (size_t chunk = 0; chunk < n_chunks; ++chunk)
+        {
+            int slot = chunk % n_stream_slots;
+            size_t begin = chunk * chunkSize;
+            size_t count = std::min(chunkSize, N - begin);
+
+            // Every chunk but the first one needs the last element of the previous chunk as halo
+            size_t halo = (chunk > 0) ? 1 : 0;
+
+            // Upload once the previous kernel of the slot has read its input
+            std::vector<cl::Event> upload_wait, kernel_wait, download_wait;
+            if (slot_used[slot])
+                upload_wait.push_back(kernel_done[slot]);
+
+            cl::Event upload_done;
+            upload_queue.enqueueWriteBuffer(bufs_in[slot], CL_FALSE, sizeof(cl_float) * (1 - halo), sizeof(cl_float) * (count + halo),
+                                            input + begin - halo, &upload_wait, &upload_done);
+
+            // Compute once the upload is done and the previous download of the slot has read its output
+            kernel_wait.push_back(upload_done);
+            if (slot_used[slot])
+                kernel_wait.push_back(download_done[slot]);
+
+            kernel.setArg(0, bufs_in[slot]);        //__global DATA_TYPE* vec_in
+            kernel.setArg(1, bufs_out[slot]);       //__global DATA_TYPE* vec_out
+            kernel.setArg(2, chunk == 0 ? 1 : 0);   // int first_chunk
+            compute_queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(count), cl::NullRange, &kernel_wait, &kernel_done[slot]);
+
+            // Download straight into the mapped output file
+            download_wait.push_back(kernel_done[slot]);
+            download_queue.enqueueReadBuffer(bufs_out[slot], CL_FALSE, 0, sizeof(cl_float) * count,
+                                             output + begin, &download_wait, &download_done[slot]);
+
+            slot_used[slot] = true;
+
+            // Make sure the commands are submitted to the device right away
+            upload_queue.flush();
+            compute_queue.flush();
+            download_queue.flush();
+        }
+
+        upload_queue.finish();
+        compute_queue.finish();
+        download_queue.finish();
+    }
+    catch (...)
+    {
+        // Let the commands already enqueued finish before the files are unmapped, downloads write straight into them
+        upload_queue.finish();
+        compute_queue.finish();
+        download_queue.finish();
+        throw;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto dt = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+
+    // Read + written bytes per second, including the disk
+    double bandwidth = 2.0 * bytes / (dt * 1e-6) / 1e9;
+    std::cout << "Streamed adjacent_difference of N = " << N << " floats in " << n_chunks << " chunks of " << chunkSize
+              << " elements: " << dt << " us, " << bandwidth << " GB/s." << std::endl;
+
+    // Check against std::adjacent_difference element by element on the mapped files, so the chunk boundaries are covered too
+    bool same = (output[0] == input[0]);
+    for (size_t i = 1; i < N && same; ++i)
+        same = (output[i] == input[i] - input[i - 1]);
+    if (same)
+        std::cout << "Streamed adjacent_difference provided the same results as we can get with std::adjacent_difference()." << std::endl;
+    else
+        std::cout << "The results of streamed adjacent_difference and the results of std::adjacent_difference are not the same." << std::endl;
+
+    msync(output_map.address, bytes, MS_SYNC);
+}
+
+void generate_input_file(const std::string& path, size_t N)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error{ "Cannot create file: " + path };
+
+    // Fill with random values between 0 and 100, written in chunks so N is not limited by the host memory
+    auto prng = [engine = std::default_random_engine{},
+                 distribution = std::uniform_real_distribution<cl_float>{ 0.0, 100.0 }]() mutable { return distribution(engine); };
+
+    std::vector<cl_float> chunk(std::min(N, default_chunk_size));
+    for (size_t written = 0; written < N; written += chunk.size())
+    {
+        size_t count = std::min(chunk.size(), N - written);
+        std::generate_n(std::begin(chunk), count, prng);
+        file.write(reinterpret_cast<const char*>(chunk.data()), sizeof(cl_float) * count);
+    }
+}
+
+void benchmark_adjacent_difference(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program,
+                                   const std::string& source_tiled, const std::string& source_scan)
+{
+    // Kernels of the sweep, all for float elements
+    cl::Program program_tiled{ source_tiled };
+    cl::Program program_scan{ source_scan };
+    program_tiled.build({ device }, ("-DCOARSEN=" + std::to_string(coarsen)).c_str());
+    program_scan.build({ device });
+
+    cl::Kernel kernel_naive(program, "adjacent_difference");
+    cl::Kernel kernel_tiled(program_tiled, "adjacent_difference_tiled");
+    cl::Kernel kernel_scan(program_scan, "scan_workgroup");
+    cl::Kernel kernel_add(program_scan, "add_group_sums");
+
+    // The look-back scan is only built when the device has 64 bit atomics
+    bool lookback = lookback_scan_available(device);
+    cl::Kernel kernel_lookback;
+    if (lookback)
+        kernel_lookback = cl::Kernel(program_scan, "scan_decoupled_lookback");
+
+    std::vector<benchmark_point> points;
+    auto record = [&points](const std::string& kernel, size_t N, size_t workGroupSize, double seconds)
+    {
+        // Every kernel has to read and write every element once, and does one operation per element
+        points.push_back({ kernel, N, workGroupSize, seconds, 2.0 * sizeof(cl_float) * N, static_cast<double>(N) });
+        print_benchmark_point(points.back());
+    };
+
+    // Problem sizes from 64K to 64M elements, as long as the device can allocate them
+    for (size_t N = 1 << 16; N <= (1 << 26); N *= 4)
+    {
+        if (sizeof(cl_float) * N > device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>())
+            break;
+
+        cl::Buffer buf_in(context, CL_MEM_READ_ONLY, sizeof(cl_float) * N);
+        cl::Buffer buf_out(context, CL_MEM_READ_WRITE, sizeof(cl_float) * N);
+        queue.enqueueFillBuffer(buf_in, cl_float{ 1.0f }, 0, sizeof(cl_float) * N);
+
+        for (size_t workGroupSize : sweep_work_group_sizes(kernel_naive, device))
+        {
+            kernel_naive.setArg(0, buf_in);
+            kernel_naive.setArg(1, buf_out);
+            record("adjacent_difference", N, workGroupSize, time_kernel(queue, kernel_naive, cl::NDRange(N), cl::NDRange(workGroupSize)));
+        }
+
+        for (size_t workGroupSize : sweep_work_group_sizes(kernel_tiled, device))
+        {
+            size_t tileSize = workGroupSize * coarsen * 4;
+            if (sizeof(cl_float) * (tileSize + 1) > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+                break;
+
+            size_t n_groups = (N + tileSize - 1) / tileSize;
+            kernel_tiled.setArg(0, buf_in);
+            kernel_tiled.setArg(1, buf_out);
+            kernel_tiled.setArg(2, sizeof(cl_float) * (tileSize + 1), nullptr);
+            kernel_tiled.setArg(3, static_cast<cl_uint>(N));
+            record("adjacent_difference_tiled", N, workGroupSize,
+                   time_kernel(queue, kernel_tiled, cl::NDRange(n_groups * workGroupSize), cl::NDRange(workGroupSize)));
+        }
+
+        for (size_t workGroupSize : sweep_work_group_sizes(kernel_scan, device, kernel_add.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device)))
+        {
+            if (sizeof(cl_float) * 2 * workGroupSize > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+                break;
+
+            // Scratch buffers are allocated outside of the timed region, the timings only cover the kernels
+            scan_scratch scratch = create_scan_scratch(context, N, sizeof(cl_float), workGroupSize);
+            record("scan (3 pass)", N, workGroupSize, time_best_of(5, [&]()
+            {
+                scan_via_gpu(queue, kernel_scan, kernel_add, buf_in, buf_out, N, sizeof(cl_float), workGroupSize, true, scratch);
+                queue.finish();
+            }));
+        }
+
+        if (!lookback)
+            continue;
+
+        for (size_t workGroupSize : sweep_work_group_sizes(kernel_lookback, device))
+        {
+            if (sizeof(cl_float) * 2 * workGroupSize > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+                break;
+
+            lookback_scratch scratch = create_lookback_scratch(context, N, workGroupSize);
+            record("scan (decoupled look-back)", N, workGroupSize, time_best_of(5, [&]()
+            {
+                scan_decoupled_lookback_via_gpu(queue, kernel_lookback, buf_in, buf_out, N, sizeof(cl_float), workGroupSize, true, scratch);
+                queue.finish();
+            }));
+        }
+    }
+
+    finish_benchmark(context, queue, device, points, "benchmark_adjacent_difference.csv");
+}
@@ -0,0 +1,73 @@
+// Element type can be chosen at build time, e.g. program.build("-DDATA_TYPE=double")
+#ifndef DATA_TYPE
+#define DATA_TYPE float
+#endif
+
+// Number of 4 wide vectors handled by one work item
+#ifndef COARSEN
+#define COARSEN 4
+#endif
+
+#ifdef cl_khr_fp64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+// DATA_TYPE4 is the 4 wide vector type of DATA_TYPE, e.g. float4
+#define CONCAT(a, b) a ## b
+#define VECTOR4(type) CONCAT(type, 4)
+#define DATA_TYPE4 VECTOR4(DATA_TYPE)
+
+// Every workgroup handles a tile of local_size * COARSEN * 4 elements, tile must hold one more element for the halo
+__kernel void adjacent_difference_tiled(__global const DATA_TYPE* vec_in, __global DATA_TYPE* vec_out, __local DATA_TYPE* tile, uint n)
+{
+    int lid = get_local_id(0);         // id of the work item in the workgroup
+    int localSize = get_local_size(0); // size of the workgroup
+    size_t tile_start = get_group_id(0) * localSize * COARSEN * 4;
+
+    // tile[0] is the halo: the last element of the previous tile
+    if (lid == 0)
+        tile[0] = (tile_start > 0) ? vec_in[tile_start - 1] : 0;
+
+    // transfer from global to local memory, consecutive work items load consecutive vectors
+    for (int c = 0; c < COARSEN; ++c)
+    {
+        int v = c * localSize + lid;   // index of the vector in the tile
+        size_t i = tile_start + 4 * v; // index of its first element in vec_in
+
+        if (i + 3 < n)
+            vstore4(vload4(0, vec_in + i), 0, tile + 1 + 4 * v);
+        else
+            for (int k = 0; k < 4; ++k)
+                if (i + k < n)
+                    tile[1 + 4 * v + k] = vec_in[i + k];
+    }
+
+    // make sure the whole tile is loaded before anyone reads its neighbors
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // every element is the pair-wise difference of indices (i, i-1), the previous elements are the tile shifted by one
+    for (int c = 0; c < COARSEN; ++c)
+    {
+        int v = c * localSize + lid;
+        size_t i = tile_start + 4 * v;
+
+        if (i + 3 < n)
+        {
+            DATA_TYPE4 current = vload4(0, tile + 1 + 4 * v);
+            DATA_TYPE4 previous = vload4(0, tile + 4 * v);
+            DATA_TYPE4 result = current - previous;
+
+            // First element of the vec_out is the first element of the vec_in
+            if (i == 0)
+                result.s0 = current.s0;
+
+            vstore4(result, 0, vec_out + i);
+        }
+        else
+        {
+            for (int k = 0; k < 4; ++k)
+                if (i + k < n)
+                    vec_out[i + k] = (i + k == 0) ? tile[1 + 4 * v + k] : tile[1 + 4 * v + k] - tile[4 * v + k];
+        }
+    }
+}
@@ -0,0 +1,184 @@
+// Element type can be chosen at build time, e.g. program.build("-DDATA_TYPE=int")
+#ifndef DATA_TYPE
+#define DATA_TYPE float
+#endif
+
+// Status flags of a tile used by the decoupled look-back scan
+#define STATUS_NOT_READY 0 // nothing published yet
+#define STATUS_AGGREGATE 1 // sum of the tile itself is published
+#define STATUS_PREFIX    2 // inclusive prefix (sum of every element up to the end of the tile) is published
+
+// The look-back publishes the status and the value of a tile together in one 64 bit word, status in the high half,
+// bits of the (32 bit) value in the low half, so a single atomic read always sees a value matching its status
+#ifdef cl_khr_int64_base_atomics
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+
+#define AS_TYPE_(type) as_##type
+#define AS_TYPE(type) AS_TYPE_(type)
+
+#define PACK_STATE(status, value) (((ulong)(status) << 32) | as_uint(value))
+#define STATE_STATUS(state) ((int)((state) >> 32))
+#define STATE_VALUE(state) AS_TYPE(DATA_TYPE)((uint)(state))
+#endif
+
+// Work-efficient (Blelloch) exclusive scan of the 2 * local_size long tile held in local memory.
+// Every work item of the workgroup has to call it, returns the total sum of the tile.
+DATA_TYPE scan_tile(__local DATA_TYPE* tile)
+{
+    int lid = get_local_id(0);     // id of the work item in the workgroup
+    int n = 2 * get_local_size(0); // size of the tile, every work item handles 2 elements
+    int offset = 1;
+
+    // Upsweep: build the tree of partial sums in place
+    for (int d = n >> 1; d > 0; d >>= 1)
+    {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid < d)
+        {
+            int ai = offset * (2 * lid + 1) - 1;
+            int bi = offset * (2 * lid + 2) - 1;
+            tile[bi] += tile[ai];
+        }
+        offset *= 2;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // The root of the tree is the sum of the whole tile, everyone reads it before it gets cleared
+    DATA_TYPE total = tile[n - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid == 0)
+        tile[n - 1] = 0;
+
+    // Downsweep: push the partial sums back down the tree
+    for (int d = 1; d < n; d *= 2)
+    {
+        offset >>= 1;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid < d)
+        {
+            int ai = offset * (2 * lid + 1) - 1;
+            int bi = offset * (2 * lid + 2) - 1;
+            DATA_TYPE t = tile[ai];
+            tile[ai] = tile[bi];
+            tile[bi] += t;
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    return total;
+}
+
+// First pass of the three pass scan: scan every tile on its own and save the sum of each tile
+__kernel void scan_workgroup(__global const DATA_TYPE* vec_in, __global DATA_TYPE* vec_out, __global DATA_TYPE* group_sums,
+                             __local DATA_TYPE* tile, uint n, int inclusive)
+{
+    int lid = get_local_id(0);
+    size_t i0 = get_group_id(0) * 2 * get_local_size(0) + 2 * lid;
+    size_t i1 = i0 + 1;
+
+    // transfer from global to local memory, zero pad past the end of the data
+    DATA_TYPE x0 = (i0 < n) ? vec_in[i0] : 0;
+    DATA_TYPE x1 = (i1 < n) ? vec_in[i1] : 0;
+    tile[2 * lid] = x0;
+    tile[2 * lid + 1] = x1;
+
+    DATA_TYPE total = scan_tile(tile);
+
+    // the inclusive scan is the exclusive one plus the element itself
+    if (i0 < n)
+        vec_out[i0] = inclusive ? tile[2 * lid] + x0 : tile[2 * lid];
+    if (i1 < n)
+        vec_out[i1] = inclusive ? tile[2 * lid + 1] + x1 : tile[2 * lid + 1];
+
+    if (lid == 0)
+        group_sums[get_group_id(0)] = total;
+}
+
+// Last pass of the three pass scan: add the (exclusively scanned) sum of the previous tiles to every element of the tile
+__kernel void add_group_sums(__global DATA_TYPE* vec_out, __global const DATA_TYPE* scanned_group_sums, uint n)
+{
+    int lid = get_local_id(0);
+    size_t i0 = get_group_id(0) * 2 * get_local_size(0) + 2 * lid;
+    size_t i1 = i0 + 1;
+
+    DATA_TYPE previous_sum = scanned_group_sums[get_group_id(0)];
+
+    if (i0 < n)
+        vec_out[i0] += previous_sum;
+    if (i1 < n)
+        vec_out[i1] += previous_sum;
+}
+
+#ifdef cl_khr_int64_base_atomics
+// Single pass scan: every tile publishes its sum, then looks back on the tiles before it until it finds an inclusive prefix.
+// tile_state and tile_counter must be zero filled before the launch, DATA_TYPE has to be a 32 bit type.
+// Waiting on other workgroups relies on forward progress OpenCL does not guarantee: tiles are numbered in the order
+// the workgroups start, so a tile only waits on workgroups that are already resident, which GPUs run to completion.
+// Without cl_khr_int64_base_atomics the kernel is left out, the host falls back to the three pass scan.
+__kernel void scan_decoupled_lookback(__global const DATA_TYPE* vec_in, __global DATA_TYPE* vec_out,
+                                      __global volatile ulong* tile_state, __global volatile int* tile_counter,
+                                      __local DATA_TYPE* tile, uint n, int inclusive)
+{
+    __local int tile_id;
+    __local DATA_TYPE tile_exclusive;
+
+    int lid = get_local_id(0);
+
+    if (lid == 0)
+        tile_id = atomic_inc(tile_counter);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    int id = tile_id;
+
+    size_t i0 = (size_t)id * 2 * get_local_size(0) + 2 * lid;
+    size_t i1 = i0 + 1;
+
+    // transfer from global to local memory, zero pad past the end of the data
+    DATA_TYPE x0 = (i0 < n) ? vec_in[i0] : 0;
+    DATA_TYPE x1 = (i1 < n) ? vec_in[i1] : 0;
+    tile[2 * lid] = x0;
+    tile[2 * lid + 1] = x1;
+
+    DATA_TYPE total = scan_tile(tile);
+
+    // Look-back is done by a single work item of the workgroup
+    if (lid == 0)
+    {
+        DATA_TYPE exclusive = 0;
+
+        if (id == 0)
+            atom_xchg(&tile_state[0], PACK_STATE(STATUS_PREFIX, total));
+        else
+        {
+            // publish the sum of this tile so the tiles after us do not have to wait for our look-back
+            atom_xchg(&tile_state[id], PACK_STATE(STATUS_AGGREGATE, total));
+
+            // walk backwards, the first tile always publishes a prefix, so this stops at the latest there
+            int predecessor = id - 1;
+            while (predecessor >= 0)
+            {
+                // atomic read of the status and the value together
+                ulong state;
+                do
+                    state = atom_or(&tile_state[predecessor], (ulong)0);
+                while (STATE_STATUS(state) == STATUS_NOT_READY);
+
+                exclusive += STATE_VALUE(state);
+                if (STATE_STATUS(state) == STATUS_PREFIX)
+                    break;
+                --predecessor;
+            }
+
+            DATA_TYPE prefix = exclusive + total;
+            atom_xchg(&tile_state[id], PACK_STATE(STATUS_PREFIX, prefix));
+        }
+
+        tile_exclusive = exclusive;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (i0 < n)
+        vec_out[i0] = tile_exclusive + (inclusive ? tile[2 * lid] + x0 : tile[2 * lid]);
+    if (i1 < n)
+        vec_out[i1] = tile_exclusive + (inclusive ? tile[2 * lid + 1] + x1 : tile[2 * lid + 1]);
+}
+#endif
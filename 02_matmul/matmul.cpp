@@ -10,9 +10,25 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <cmath>
+#include <numeric>
 
+// Shared helpers
+#include "zero_copy.hpp"
+#include "multi_device.hpp"
+#include "benchmark.hpp"
 
-int main()
+// Function to compute A * B with matmul0 on every device, each device computes a block of rows of the result
+void matmul0_via_multiple_devices(const host_vector<float>& A, const host_vector<float>& B, host_vector<float>& C, int size,
+                                  const std::string& source_matmul0, unsigned int sub_devices_per_cpu);
+
+// Function to get the largest absolute difference of GPU and CPU results
+float max_abs_difference(const float* result_GPU, const std::vector<float>& result_CPU);
+
+// Function to sweep matrix sizes and work group sizes of matmul0 and matmul1, then print a roofline style summary
+void benchmark_matmul(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program_matmul0, cl::Program program_matmul1);
+
+int main(int argc, char* argv[])
 {
 	std::cout << "main() started" << std::endl;
 	try
@@ -34,13 +50,26 @@ int main()
             throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + "matmul1.cl" };
 
         // Create cl::Program from kernels and build them for the device
-        cl::Program program_matmul0{ std::string{ std::istreambuf_iterator<char>{ source_file_matmul0 },
-                                          std::istreambuf_iterator<char>{} } };
+        std::string source_matmul0{ std::istreambuf_iterator<char>{ source_file_matmul0 }, std::istreambuf_iterator<char>{} };
+        cl::Program program_matmul0{ source_matmul0 };
         cl::Program program_matmul1{ std::string{ std::istreambuf_iterator<char>{ source_file_matmul1 },
                                           std::istreambuf_iterator<char>{} } };
         program_matmul0.build({ device });
         program_matmul1.build({ device });
 
+        // Benchmark mode works on its own matrix sizes
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--benchmark" && argc == 2)
+        {
+            benchmark_matmul(context, queue, device, program_matmul0, program_matmul1);
+            return 0;
+        }
+        else if (!mode.empty() && !(mode == "--multi-device" && argc <= 3))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--benchmark | --multi-device [sub-devices per CPU]]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
 /*TODO: matmul1 from here on is missing*/
 
         // Create KernelFunctors for the kernels 
@@ -48,8 +77,9 @@ int main()
 
         // Initialize computation
         constexpr int size = 1024; 
-        std::vector<float> A(size*size), B(size*size);
-        std::vector<float> matmul0_result_GPU(size*size), matmul0_result_CPU(size*size);
+        host_vector<float> A(size*size), B(size*size);
+        host_vector<float> matmul0_result_GPU(size*size);
+        std::vector<float> matmul0_result_CPU(size*size);
 
         // Create random number generator: uniform distribution between -1 and 1
         std::random_device rnd_device;
@@ -63,28 +93,35 @@ int main()
         std::fill(matmul0_result_GPU.begin(), matmul0_result_GPU.end(), 0.0f);
         std::fill(matmul0_result_CPU.begin(), matmul0_result_CPU.end(), 0.0f);
 
-        // Create buffers: we only want to read the A and B matrices, and we want to write the result matrices
-        cl::Buffer buf_A{ std::begin(A), std::end(A), true };
-        cl::Buffer buf_B{ std::begin(B), std::end(B), true };    
-        cl::Buffer buf_matmul0_result{ std::begin(matmul0_result_GPU), std::end(matmul0_result_GPU), false }; 
+        // If the device shares memory with the host, the buffers use the matrices directly instead of copies
+        bool zero_copy = zero_copy_available(device);
+        std::cout << (zero_copy ? "Zero-copy mode: device shares memory with the host." : "Copy mode: device has its own memory.") << std::endl;
 
-        // Dispatch of data before launch, a.k.a. copy the matrices into the cl::Buffers
-        cl::copy(queue, std::begin(A), std::end(A), buf_A);
-        cl::copy(queue, std::begin(B), std::end(B), buf_B);
-        cl::copy(queue, std::begin(matmul0_result_GPU), std::end(matmul0_result_GPU), buf_matmul0_result);
+        // Create buffers: we only want to read the A and B matrices, and we want to write the result matrices
+        // Dispatch of data before launch, a.k.a. copy the matrices into the cl::Buffers (or just hand them over in zero-copy mode)
+        auto tStart_dispatch = std::chrono::high_resolution_clock::now();
+        cl::Buffer buf_A = create_input_buffer(queue, context, CL_MEM_READ_ONLY, A, zero_copy);
+        cl::Buffer buf_B = create_input_buffer(queue, context, CL_MEM_READ_ONLY, B, zero_copy);
+        cl::Buffer buf_matmul0_result = create_output_buffer(context, CL_MEM_WRITE_ONLY, matmul0_result_GPU, zero_copy);
+        auto tEnd_dispatch = std::chrono::high_resolution_clock::now();
 
         // Launch matmul0  kernel and measure the computation time
         auto tStart_matmul0_GPU = std::chrono::high_resolution_clock::now(); 
 
-        matmul0(cl::EnqueueArgs{ queue, cl::NDRange{ size*size } }, buf_A, buf_B, buf_matmul0_result, size);
+        matmul0(cl::EnqueueArgs{ queue, cl::NDRange{ size, size } }, buf_A, buf_B, buf_matmul0_result, size);
         cl::finish(); // Wait for the started kernel to finish
 
         auto tEnd_matmul0_GPU = std::chrono::high_resolution_clock::now();
         auto dt_matmul0_GPU = std::chrono::duration_cast<std::chrono::microseconds>(tEnd_matmul0_GPU - tStart_matmul0_GPU).count();
         std::cout << "matmul0 GPU computation time : " << dt_matmul0_GPU << " ms." << std::endl;
         
-        // Fetch of results, a.k.a. copy the results from buf_matmul0_result to matmul0_result_GPU
-        cl::copy(queue, buf_matmul0_result,  std::begin(matmul0_result_GPU), std::end(matmul0_result_GPU));
+        // Fetch of results, a.k.a. copy the results from buf_matmul0_result to matmul0_result_GPU (or map it in zero-copy mode, until results goes out of scope)
+        auto tStart_fetch = std::chrono::high_resolution_clock::now();
+        auto results = fetch_buffer(queue, buf_matmul0_result, matmul0_result_GPU, zero_copy);
+        auto tEnd_fetch = std::chrono::high_resolution_clock::now();
+
+        auto dt_transfer = std::chrono::duration_cast<std::chrono::microseconds>((tEnd_dispatch - tStart_dispatch) + (tEnd_fetch - tStart_fetch)).count();
+        std::cout << "matmul0 dispatch + fetch time : " << dt_transfer << " us." << std::endl;
 
         // Calculate matmul0 style with CPU as well
         auto tStart_matmul0_CPU = std::chrono::high_resolution_clock::now(); // Record start time
@@ -103,6 +140,23 @@ int main()
         auto tEnd_matmul0_CPU = std::chrono::high_resolution_clock::now(); // Record end time
         auto dt_matmul0_CPU = std::chrono::duration_cast<std::chrono::microseconds>(tEnd_matmul0_CPU - tStart_matmul0_CPU).count();
         std::cout << "matmul0 CPU computation time : " << dt_matmul0_CPU << " ms." << std::endl;
+        std::cout << "matmul0 max abs difference of GPU and CPU results : " << max_abs_difference(results.data(), matmul0_result_CPU) << std::endl;
+
+        // Multi-device mode: the rows of the result are split across every device of the host
+        if (mode == "--multi-device")
+        {
+            unsigned int sub_devices_per_cpu = (argc > 2) ? std::stoul(argv[2]) : 0;
+            host_vector<float> matmul0_result_multi_device(size*size);
+
+            auto tStart_matmul0_multi_device = std::chrono::high_resolution_clock::now();
+            matmul0_via_multiple_devices(A, B, matmul0_result_multi_device, size, source_matmul0, sub_devices_per_cpu);
+            auto tEnd_matmul0_multi_device = std::chrono::high_resolution_clock::now();
+            auto dt_matmul0_multi_device = std::chrono::duration_cast<std::chrono::microseconds>(tEnd_matmul0_multi_device - tStart_matmul0_multi_device).count();
+
+            std::cout << "matmul0 multi-device computation time (with transfers) : " << dt_matmul0_multi_device << " us." << std::endl;
+            std::cout << "matmul0 multi-device max abs difference of GPU and CPU results : "
+                      << max_abs_difference(matmul0_result_multi_device.data(), matmul0_result_CPU) << std::endl;
+        }
 
 	}
 
@@ -135,3 +189,124 @@ int main()
 
 
 }
+
+void matmul0_via_multiple_devices(const host_vector<float>& A, const host_vector<float>& B, host_vector<float>& C, int size,
+                                  const std::string& source_matmul0, unsigned int sub_devices_per_cpu)
+{
+    std::vector<device_context> devices = select_all_devices(sub_devices_per_cpu);
+    size_t n_devices = devices.size();
+
+    // Build the kernel and upload B (every device needs all of it) for every device
+    std::vector<cl::Kernel> kernels(n_devices);
+    std::vector<cl::Buffer> bufs_B(n_devices);
+    bool B_in_use = false;
+    for (size_t i = 0; i < n_devices; ++i)
+    {
+        cl::Program program{ devices[i].context, source_matmul0 };
+        program.build({ devices[i].device });
+        kernels[i] = cl::Kernel(program, "matmul0");
+        // The first device sharing memory with the host reads B in place, the others get a copy:
+        // the same host memory must not back buffers of several contexts at once
+        bool zero_copy = !B_in_use && zero_copy_available(devices[i].device, B.data());
+        B_in_use = B_in_use || zero_copy;
+        cl_mem_flags host_ptr_flag = zero_copy ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR;
+        bufs_B[i] = cl::Buffer(devices[i].context, CL_MEM_READ_ONLY | host_ptr_flag, sizeof(float) * size * size, const_cast<float*>(B.data()));
+    }
+
+    // Device i computes rows [row_begin, row_begin + rows) of C from the same rows of A
+    auto compute_rows = [&](size_t i, size_t row_begin, size_t rows)
+    {
+        if (rows == 0)
+            return;
+
+        // Rows of A are read in place if the device shares memory with the host and they start on a page
+        float* A_rows = const_cast<float*>(A.data()) + row_begin * size;
+        cl_mem_flags host_ptr_flag = zero_copy_available(devices[i].device, A_rows) ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR;
+        cl::Buffer buf_A(devices[i].context, CL_MEM_READ_ONLY | host_ptr_flag, sizeof(float) * rows * size, A_rows);
+        cl::Buffer buf_C(devices[i].context, CL_MEM_WRITE_ONLY, sizeof(float) * rows * size);
+
+        kernels[i].setArg(0, buf_A);
+        kernels[i].setArg(1, bufs_B[i]);
+        kernels[i].setArg(2, buf_C);
+        kernels[i].setArg(3, size);
+        devices[i].queue.enqueueNDRangeKernel(kernels[i], cl::NullRange, cl::NDRange(size, rows), cl::NullRange);
+        devices[i].queue.enqueueReadBuffer(buf_C, CL_TRUE, 0, sizeof(float) * rows * size, C.data() + row_begin * size);
+    };
+
+    // Throughput of every device in rows per second, then split the rows in proportion
+    std::vector<double> throughputs = measure_throughputs(n_devices, std::min(size, 32), [&](size_t i, size_t rows) { compute_rows(i, 0, rows); });
+    std::vector<size_t> rows = split_by_throughput(size, throughputs);
+
+    // Move the boundaries onto rows starting on a page, so zero-copy devices read their rows of A in place,
+    // unless the matrix is too small to give every device at least one page of rows
+    size_t page_rows = zero_copy_alignment / sizeof(float) / std::gcd(static_cast<size_t>(size), zero_copy_alignment / sizeof(float));
+    if (page_rows * n_devices <= static_cast<size_t>(size))
+        rows = align_split(rows, page_rows);
+    std::vector<size_t> row_begins(n_devices, 0);
+    for (size_t i = 1; i < n_devices; ++i)
+        row_begins[i] = row_begins[i - 1] + rows[i - 1];
+
+    for (size_t i = 0; i < n_devices; ++i)
+        std::cout << "matmul0 on device " << i << " (" << devices[i].name << "): " << throughputs[i] << " rows/s, " << rows[i] << " rows" << std::endl;
+
+    run_on_all_devices(n_devices, [&](size_t i) { compute_rows(i, row_begins[i], rows[i]); });
+}
+
+float max_abs_difference(const float* result_GPU, const std::vector<float>& result_CPU)
+{
+    float max_difference = 0.0f;
+    for (size_t i = 0; i < result_CPU.size(); ++i)
+        max_difference = std::max(max_difference, std::abs(result_GPU[i] - result_CPU[i]));
+    return max_difference;
+}
+
+void benchmark_matmul(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program_matmul0, cl::Program program_matmul1)
+{
+    cl::Kernel kernel_matmul0(program_matmul0, "matmul0");
+    cl::Kernel kernel_matmul1(program_matmul1, "matmul1");
+    size_t max_work_group_size = std::min(kernel_matmul0.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device),
+                                          kernel_matmul1.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+
+    std::vector<benchmark_point> points;
+
+    for (int size = 128; size <= 2048; size *= 2)
+    {
+        cl::Buffer buf_A(context, CL_MEM_READ_ONLY, sizeof(float) * size * size);
+        cl::Buffer buf_B(context, CL_MEM_READ_ONLY, sizeof(float) * size * size);
+        cl::Buffer buf_C(context, CL_MEM_WRITE_ONLY, sizeof(float) * size * size);
+        queue.enqueueFillBuffer(buf_A, 1.0f, 0, sizeof(float) * size * size);
+        queue.enqueueFillBuffer(buf_B, 1.0f, 0, sizeof(float) * size * size);
+
+        // Each of A, B and C has to be moved once at least, every element of C takes size multiply-adds
+        double bytes = 3.0 * sizeof(float) * size * size;
+        double flops = 2.0 * size * size * size;
+
+        // Square blocksize * blocksize work groups, matmul1 uses the same blocks as tiles
+        for (int blocksize = 4; blocksize <= 32 && static_cast<size_t>(blocksize * blocksize) <= max_work_group_size; blocksize *= 2)
+        {
+            kernel_matmul0.setArg(0, buf_A);
+            kernel_matmul0.setArg(1, buf_B);
+            kernel_matmul0.setArg(2, buf_C);
+            kernel_matmul0.setArg(3, size);
+            double seconds_matmul0 = time_kernel(queue, kernel_matmul0, cl::NDRange(size, size), cl::NDRange(blocksize, blocksize), 3);
+            points.push_back({ "matmul0", static_cast<size_t>(size), static_cast<size_t>(blocksize * blocksize), seconds_matmul0, bytes, flops });
+            print_benchmark_point(points.back());
+
+            if (2 * sizeof(float) * blocksize * blocksize > device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+                continue;
+
+            kernel_matmul1.setArg(0, buf_A);
+            kernel_matmul1.setArg(1, buf_B);
+            kernel_matmul1.setArg(2, buf_C);
+            kernel_matmul1.setArg(3, size);
+            kernel_matmul1.setArg(4, blocksize);
+            kernel_matmul1.setArg(5, sizeof(float) * blocksize * blocksize, nullptr);
+            kernel_matmul1.setArg(6, sizeof(float) * blocksize * blocksize, nullptr);
+            double seconds_matmul1 = time_kernel(queue, kernel_matmul1, cl::NDRange(size, size), cl::NDRange(blocksize, blocksize), 3);
+            points.push_back({ "matmul1", static_cast<size_t>(size), static_cast<size_t>(blocksize * blocksize), seconds_matmul1, bytes, flops });
+            print_benchmark_point(points.back());
+        }
+    }
+
+    finish_benchmark(context, queue, device, points, "benchmark_matmul.csv");
+}
@@ -1,13 +1,13 @@
-__kernel void matmul0(__global double* A, 
-                      __global double* B, 
-                      __global double* C, 
+__kernel void matmul0(__global float* A, 
+                      __global float* B, 
+                      __global float* C, 
                       int size)
 {
   
    int thx = get_global_id(0); 
    int thy = get_global_id(1);
 
-   double acc = 0.0;
+   float acc = 0.0f;
    for (int i = 0; i < size; ++i)
    {
       acc += A[thy * size + i] * B[i * size + thx];
@@ -1,10 +1,10 @@
-__kernel void matmul1(__global double* A,
-                      __global double* B,
-                      __global double* C,
+__kernel void matmul1(__global float* A,
+                      __global float* B,
+                      __global float* C,
 					           int    size,
                                int    blocksize,
-                      __local  double* Ablock,
-					  __local  double* Bblock)
+                      __local  float* Ablock,
+					  __local  float* Bblock)
 {
 	int lx = get_local_id(0);
 	int ly = get_local_id(1);
@@ -13,7 +13,7 @@ __kernel void matmul1(__global double* A,
 	int gy = get_global_id(1);
 
 	int steps = size / blocksize;
-	double acc = 0.0;
+	float acc = 0.0f;
 	for( int s=0; s<steps; s=s+1)
 	{
 		int Ablockoffset = ly * blocksize + lx;
@@ -28,8 +28,8 @@ __kernel void matmul1(__global double* A,
 
 		for (int i = 0; i < blocksize; ++i)
 		{
-			double fA = Ablock[ly*blocksize+i];
-			double fB = Bblock[lx*blocksize+i];
+			float fA = Ablock[ly*blocksize+i];
+			float fB = Bblock[lx*blocksize+i];
 			acc += fA * fB;
 		}
 
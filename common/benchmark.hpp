@@ -0,0 +1,218 @@
+// Shared benchmarking helpers of the OpenCL projects
+#pragma once
+
+// OpenCL include
+#include <OpenCL/opencl.hpp>
+
+// Standard C++ includes
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+// Location of the shared kernel sources, relative to the build directory of a project
+#define COMMON_KERNEL_DIR "../../common/"
+
+// Number of multiply-add steps of the fma_throughput kernel, must match FMA_ITERATIONS of microbenchmarks.cl
+constexpr int fma_iterations = 256;
+
+// One measured point of a size / work group size sweep
+struct benchmark_point
+{
+    std::string kernel;
+    size_t problem_size;
+    size_t work_group_size;
+    double seconds;
+    double bytes; // bytes the kernel has to move at least (compulsory traffic)
+    double flops; // floating point operations of the kernel
+};
+
+// Function to read a kernel source file into a string
+inline std::string load_kernel_source(const std::string& file_name)
+{
+    std::ifstream source_file{ file_name };
+    if (!source_file.is_open())
+        throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + file_name };
+
+    return std::string{ std::istreambuf_iterator<char>{ source_file }, std::istreambuf_iterator<char>{} };
+}
+
+// Function to time run() (which has to wait for its work to finish), returns the best of the repetitions in seconds after a warm up run
+inline double time_best_of(int repetitions, const std::function<void()>& run)
+{
+    // Warm up run, first launch may include lazy allocation of the buffers
+    run();
+
+    double best_seconds = 0.0;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        run();
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(t1 - t0).count();
+        if (i == 0 || seconds < best_seconds)
+            best_seconds = seconds;
+    }
+    return best_seconds;
+}
+
+// Function to time a single kernel launch with the arguments already set
+inline double time_kernel(cl::CommandQueue queue, cl::Kernel kernel, cl::NDRange global, cl::NDRange local, int repetitions = 5)
+{
+    return time_best_of(repetitions, [&]()
+    {
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+        queue.finish();
+    });
+}
+
+// Function to measure the peak memory bandwidth of the device with the stream_copy kernel, returns GB/s
+// (bytes read + bytes written per second, best of a few repetitions)
+inline double measure_peak_bandwidth(cl::Context context, cl::CommandQueue queue, cl::Device device, int repetitions = 5)
+{
+    cl::Program program{ context, load_kernel_source(COMMON_KERNEL_DIR "microbenchmarks.cl") };
+    program.build({ device });
+    cl::Kernel kernel(program, "stream_copy");
+
+    // 256 MB per buffer, or as much as the device allows in one allocation
+    size_t bytes = std::min<size_t>(256 * 1024 * 1024, device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>());
+    size_t n_vectors = bytes / (4 * sizeof(cl_float));
+    bytes = n_vectors * 4 * sizeof(cl_float);
+
+    cl::Buffer buf_in(context, CL_MEM_READ_ONLY, bytes);
+    cl::Buffer buf_out(context, CL_MEM_WRITE_ONLY, bytes);
+    queue.enqueueFillBuffer(buf_in, cl_float{ 1.0f }, 0, bytes);
+
+    kernel.setArg(0, buf_in);
+    kernel.setArg(1, buf_out);
+
+    double seconds = time_kernel(queue, kernel, cl::NDRange(n_vectors), cl::NullRange, repetitions);
+    return 2.0 * bytes / seconds / 1e9;
+}
+
+// Function to measure the peak floating point rate of the device with the fma_throughput kernel, returns GFLOP/s
+inline double measure_peak_flops(cl::Context context, cl::CommandQueue queue, cl::Device device, int repetitions = 5)
+{
+    cl::Program program{ context, load_kernel_source(COMMON_KERNEL_DIR "microbenchmarks.cl") };
+    program.build({ device }, ("-DFMA_ITERATIONS=" + std::to_string(fma_iterations)).c_str());
+    cl::Kernel kernel(program, "fma_throughput");
+
+    size_t n_work_items = 1 << 20;
+    cl::Buffer buf_out(context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * n_work_items);
+
+    kernel.setArg(0, buf_out);
+    kernel.setArg(1, cl_float{ 0.999f });
+    kernel.setArg(2, cl_float{ 0.001f });
+
+    double seconds = time_kernel(queue, kernel, cl::NDRange(n_work_items), cl::NullRange, repetitions);
+    return static_cast<double>(n_work_items) * fma_iterations * 2 * 4 * 2 / seconds / 1e9;
+}
+
+// Function to round a work group size down to a power of two, as the tree reductions and the scan tiles need it
+inline size_t power_of_two_work_group_size(size_t workGroupSize)
+{
+    size_t result = 1;
+    while (result * 2 <= workGroupSize)
+        result *= 2;
+    return result;
+}
+
+// Function to get the work group sizes of a sweep: powers of two from 16 up to the largest the kernel allows
+// (or only the largest power of two the kernel allows, if that is below 16)
+inline std::vector<size_t> sweep_work_group_sizes(cl::Kernel kernel, cl::Device device, size_t max_work_group_size = 1024)
+{
+    size_t kernel_max = std::min(max_work_group_size, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+
+    std::vector<size_t> sizes;
+    for (size_t size = 16; size <= kernel_max; size *= 2)
+        sizes.push_back(size);
+    if (sizes.empty())
+        sizes.push_back(power_of_two_work_group_size(kernel_max));
+    return sizes;
+}
+
+// Function to print one point of a sweep while it runs
+inline void print_benchmark_point(const benchmark_point& point)
+{
+    std::cout << std::left << std::setw(28) << point.kernel
+              << " size " << std::setw(12) << point.problem_size
+              << " wg " << std::setw(6) << point.work_group_size
+              << std::right << std::setw(12) << point.seconds * 1e6 << " us "
+              << std::setw(10) << point.bytes / point.seconds / 1e9 << " GB/s "
+              << std::setw(10) << point.flops / point.seconds / 1e9 << " GFLOP/s" << std::endl;
+}
+
+// Function to write every point of the sweeps into a csv file
+inline void write_benchmark_csv(const std::string& file_name, const std::vector<benchmark_point>& points)
+{
+    std::ofstream file(file_name);
+    file << "kernel,problem_size,work_group_size,seconds,bytes,flops,GB_per_s,GFLOP_per_s\n";
+    for (const auto& point : points)
+        file << point.kernel << "," << point.problem_size << "," << point.work_group_size << "," << point.seconds << ","
+             << point.bytes << "," << point.flops << "," << point.bytes / point.seconds / 1e9 << "," << point.flops / point.seconds / 1e9 << "\n";
+}
+
+// Function to print a roofline style summary: for the best point of every kernel, the arithmetic intensity,
+// the rate the roofline allows at that intensity and how far below it the kernel stays
+inline void print_roofline_summary(const std::vector<benchmark_point>& points, double peak_bandwidth, double peak_flops)
+{
+    // Below the ridge point a kernel is limited by memory, above it by the floating point units
+    auto is_memory_bound = [&](const benchmark_point& point) { return point.flops / point.bytes * peak_bandwidth < peak_flops; };
+    auto roofline_fraction = [&](const benchmark_point& point)
+    {
+        return is_memory_bound(point) ? point.bytes / point.seconds / 1e9 / peak_bandwidth : point.flops / point.seconds / 1e9 / peak_flops;
+    };
+
+    // Best point of every kernel, closest to the roofline (kernels keep the order of their first point)
+    std::vector<std::string> kernels;
+    std::map<std::string, benchmark_point> best;
+    for (const auto& point : points)
+    {
+        auto it = best.find(point.kernel);
+        if (it == best.end())
+        {
+            kernels.push_back(point.kernel);
+            best[point.kernel] = point;
+        }
+        else if (roofline_fraction(point) > roofline_fraction(it->second))
+            it->second = point;
+    }
+
+    std::cout << "\n###############################" << std::endl;
+    std::cout << "Roofline summary (peak " << peak_bandwidth << " GB/s stream copy, " << peak_flops << " GFLOP/s fma)" << std::endl;
+    for (const auto& kernel : kernels)
+    {
+        const benchmark_point& point = best[kernel];
+        double intensity = point.flops / point.bytes; // flop / byte
+        double bandwidth = point.bytes / point.seconds / 1e9;
+        double flops = point.flops / point.seconds / 1e9;
+        bool memory_bound = is_memory_bound(point);
+        double fraction = roofline_fraction(point);
+
+        std::cout << "\t" << std::left << std::setw(28) << kernel << std::right
+                  << " best at size " << point.problem_size << ", wg " << point.work_group_size
+                  << ": " << intensity << " flop/byte, " << (memory_bound ? "memory" : "compute") << " bound, "
+                  << (memory_bound ? bandwidth : flops) << (memory_bound ? " GB/s" : " GFLOP/s")
+                  << " = " << 100.0 * fraction << " % of the roofline" << std::endl;
+    }
+    std::cout << "###############################\n" << std::endl;
+}
+
+// Function to measure the peaks of the device, print the summary of the sweeps and save them into a csv file
+inline void finish_benchmark(cl::Context context, cl::CommandQueue queue, cl::Device device,
+                             const std::vector<benchmark_point>& points, const std::string& csv_file_name)
+{
+    double peak_bandwidth = measure_peak_bandwidth(context, queue, device);
+    double peak_flops = measure_peak_flops(context, queue, device);
+
+    print_roofline_summary(points, peak_bandwidth, peak_flops);
+    write_benchmark_csv(csv_file_name, points);
+    std::cout << "Benchmark points saved to " << csv_file_name << std::endl;
+}
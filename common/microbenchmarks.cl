@@ -0,0 +1,28 @@
+// Stream copy: every work item copies one float4, the achieved bandwidth is used as the peak of the device
+__kernel void stream_copy(__global const float4* vec_in, __global float4* vec_out)
+{
+    int gid = get_global_id(0);
+    vec_out[gid] = vec_in[gid];
+}
+
+// Number of multiply-add steps in the chain of fma_throughput
+#ifndef FMA_ITERATIONS
+#define FMA_ITERATIONS 256
+#endif
+
+// FMA throughput: every work item runs 2 independent chains of float4 multiply-adds, 2 flops per lane and step,
+// so a work item does FMA_ITERATIONS * 2 * 4 * 2 flops; the result is written out so the chains are not optimized away
+__kernel void fma_throughput(__global float* vec_out, float a, float b)
+{
+    int gid = get_global_id(0);
+    float4 x = (float4)(gid, gid + 1, gid + 2, gid + 3);
+    float4 y = x + 1.0f;
+
+    for (int i = 0; i < FMA_ITERATIONS; ++i)
+    {
+        x = mad(x, a, b);
+        y = mad(y, a, b);
+    }
+
+    vec_out[gid] = x.s0 + x.s1 + x.s2 + x.s3 + y.s0 + y.s1 + y.s2 + y.s3;
+}
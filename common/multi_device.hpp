@@ -0,0 +1,183 @@
+// Multi-device helpers of the OpenCL projects: select every device of the host, measure how fast each of them is,
+// split the work in proportion and run the parts on all devices at the same time
+#pragma once
+
+// OpenCL include
+#include <OpenCL/opencl.hpp>
+
+// Standard C++ includes
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <numeric>
+
+// Everything needed to run on one device
+struct device_context
+{
+    cl::Device device;
+    cl::Context context;
+    cl::CommandQueue queue;
+    std::string name;
+};
+
+// Function to select the devices of every platform, CPU devices are split into sub_devices_per_cpu sub-devices if it is > 1
+inline std::vector<device_context> select_all_devices(unsigned int sub_devices_per_cpu = 0)
+{
+    std::vector<cl::Device> devices;
+
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    for (const auto& platform : platforms)
+    {
+        std::vector<cl::Device> platform_devices;
+        platform.getDevices(CL_DEVICE_TYPE_ALL, &platform_devices);
+
+        for (auto& device : platform_devices)
+        {
+            cl_uint compute_units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+            bool is_cpu = (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) != 0;
+
+            // Partition schemes the device supports, empty if it cannot be partitioned
+            std::vector<cl_device_partition_property> schemes = device.getInfo<CL_DEVICE_PARTITION_PROPERTIES>();
+            auto supports = [&schemes](cl_device_partition_property scheme) { return std::find(schemes.begin(), schemes.end(), scheme) != schemes.end(); };
+            bool can_split = sub_devices_per_cpu <= device.getInfo<CL_DEVICE_PARTITION_MAX_SUB_DEVICES>() &&
+                             (supports(CL_DEVICE_PARTITION_BY_COUNTS) || supports(CL_DEVICE_PARTITION_EQUALLY));
+
+            if (is_cpu && sub_devices_per_cpu > 1 && compute_units >= sub_devices_per_cpu && !can_split)
+                std::cout << "LOG: " << device.getInfo<CL_DEVICE_NAME>() << " cannot be split into " << sub_devices_per_cpu
+                          << " sub-devices, it is used as a whole" << std::endl;
+
+            if (is_cpu && sub_devices_per_cpu > 1 && compute_units >= sub_devices_per_cpu && can_split)
+            {
+                // sub_devices_per_cpu partitions of equal number of compute units: by counts if possible, as partitioning
+                // equally by compute_units / sub_devices_per_cpu may give more partitions (e.g. 8 units split 3 ways gives 4)
+                cl_device_partition_property units_per_sub_device = compute_units / sub_devices_per_cpu;
+                std::vector<cl_device_partition_property> properties;
+                if (supports(CL_DEVICE_PARTITION_BY_COUNTS))
+                {
+                    properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS);
+                    properties.insert(properties.end(), sub_devices_per_cpu, units_per_sub_device);
+                    properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS_LIST_END);
+                }
+                else
+                {
+                    properties.push_back(CL_DEVICE_PARTITION_EQUALLY);
+                    properties.push_back(units_per_sub_device);
+                }
+                properties.push_back(0);
+
+                std::vector<cl::Device> sub_devices;
+                device.createSubDevices(properties.data(), &sub_devices);
+
+                // Equal partitions may leave extra sub-devices, only sub_devices_per_cpu of them are used
+                if (sub_devices.size() > sub_devices_per_cpu)
+                    sub_devices.resize(sub_devices_per_cpu);
+                devices.insert(devices.end(), sub_devices.begin(), sub_devices.end());
+            }
+            else
+                devices.push_back(device);
+        }
+    }
+
+    // Every device gets its own context and queue, so they do not wait on each other
+    std::vector<device_context> device_contexts;
+    for (auto& device : devices)
+    {
+        cl::Context context(device);
+        device_contexts.push_back({ device, context, cl::CommandQueue(context, device), device.getInfo<CL_DEVICE_NAME>() });
+    }
+
+    return device_contexts;
+}
+
+// Function to run work(i) for every device i on its own thread, rethrows the first error after every thread finished
+inline void run_on_all_devices(size_t n_devices, const std::function<void(size_t)>& work)
+{
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_devices);
+
+    for (size_t i = 0; i < n_devices; ++i)
+        threads.emplace_back([&work, &errors, i]()
+        {
+            try { work(i); }
+            catch (...) { errors[i] = std::current_exception(); }
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+// Function to measure the throughput (items per second) of every device: probe(i, probe_size) has to process probe_size items on device i.
+// Devices are measured one after the other after a warm up run, so they do not disturb each other
+inline std::vector<double> measure_throughputs(size_t n_devices, size_t probe_size, const std::function<void(size_t, size_t)>& probe)
+{
+    std::vector<double> throughputs(n_devices);
+    for (size_t i = 0; i < n_devices; ++i)
+    {
+        probe(i, probe_size);
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        probe(i, probe_size);
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(t1 - t0).count();
+        throughputs[i] = probe_size / std::max(seconds, 1e-9);
+    }
+    return throughputs;
+}
+
+// Function to split n items into parts proportional to the throughputs (largest remainder, so the parts add up to n)
+inline std::vector<size_t> split_by_throughput(size_t n, const std::vector<double>& throughputs)
+{
+    double total = std::accumulate(throughputs.begin(), throughputs.end(), 0.0);
+
+    std::vector<size_t> counts(throughputs.size());
+    std::vector<double> remainders(throughputs.size());
+    for (size_t i = 0; i < throughputs.size(); ++i)
+    {
+        double share = n * throughputs[i] / total;
+        counts[i] = static_cast<size_t>(share);
+        remainders[i] = share - counts[i];
+    }
+
+    // Hand out the items lost to rounding down to the devices with the largest remainders
+    size_t assigned = std::accumulate(counts.begin(), counts.end(), size_t{ 0 });
+    std::vector<size_t> order(throughputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&remainders](size_t a, size_t b) { return remainders[a] > remainders[b]; });
+    for (size_t k = 0; assigned < n; ++k, ++assigned)
+        ++counts[order[k % order.size()]];
+
+    return counts;
+}
+
+// Function to move the boundaries between the parts of a split onto multiples of alignment (e.g. so every part starts on a page
+// of the host memory and can be used without copies), the parts still add up to the same number of items
+inline std::vector<size_t> align_split(const std::vector<size_t>& counts, size_t alignment)
+{
+    size_t n = std::accumulate(counts.begin(), counts.end(), size_t{ 0 });
+
+    std::vector<size_t> aligned_counts(counts.size());
+    size_t begin = 0, end = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        end += counts[i];
+
+        // Nearest multiple of alignment, the last part ends at n
+        size_t aligned_end = (i + 1 == counts.size()) ? n : std::min(n, (end + alignment / 2) / alignment * alignment);
+        aligned_end = std::max(aligned_end, begin);
+
+        aligned_counts[i] = aligned_end - begin;
+        begin = aligned_end;
+    }
+    return aligned_counts;
+}
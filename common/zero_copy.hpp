@@ -0,0 +1,181 @@
+// Zero-copy helpers of the OpenCL projects: when the device shares memory with the host (e.g. CPU devices),
+// buffers live in host memory the device can use directly, and results are mapped instead of copied
+#pragma once
+
+// OpenCL include
+#include <OpenCL/opencl.hpp>
+
+// Standard C++ includes
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+// Alignment of host memory handed to CL_MEM_USE_HOST_PTR buffers, a page is enough for every runtime we know of
+constexpr size_t zero_copy_alignment = 4096;
+
+// Allocator giving page-aligned memory (with size rounded up to whole pages), so CL_MEM_USE_HOST_PTR buffers need no copies
+template <typename T>
+struct page_aligned_allocator
+{
+    using value_type = T;
+
+    page_aligned_allocator() = default;
+    template <typename U>
+    page_aligned_allocator(const page_aligned_allocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        size_t bytes = (n * sizeof(T) + zero_copy_alignment - 1) / zero_copy_alignment * zero_copy_alignment;
+        void* pointer = std::aligned_alloc(zero_copy_alignment, bytes > 0 ? bytes : zero_copy_alignment);
+        if (pointer == nullptr)
+            throw std::bad_alloc{};
+        return static_cast<T*>(pointer);
+    }
+
+    void deallocate(T* pointer, size_t) { std::free(pointer); }
+};
+
+template <typename T, typename U>
+bool operator==(const page_aligned_allocator<T>&, const page_aligned_allocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const page_aligned_allocator<T>&, const page_aligned_allocator<U>&) { return false; }
+
+// Host side vector of the data handed to the device
+template <typename T>
+using host_vector = std::vector<T, page_aligned_allocator<T>>;
+
+// Function to check if the device shares memory with the host, zero-copy mode is used if it does
+inline bool zero_copy_available(const cl::Device& device)
+{
+    return device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE;
+}
+
+// Function to check if the device can use the host memory at host_ptr without copies: it shares memory with the host
+// and host_ptr is page-aligned (parts of a host_vector handed to different devices only are if the split is aligned)
+inline bool zero_copy_available(const cl::Device& device, const void* host_ptr)
+{
+    return zero_copy_available(device) && reinterpret_cast<std::uintptr_t>(host_ptr) % zero_copy_alignment == 0;
+}
+
+// Function to create a buffer the kernels read: uses the host memory in zero-copy mode, otherwise the data is written
+// with a blocking write, so it is on the device when the function returns (CL_MEM_COPY_HOST_PTR uploads may be deferred
+// to the first use of the buffer, which would move the transfer into the kernel timings)
+template <typename T>
+cl::Buffer create_input_buffer(cl::CommandQueue queue, cl::Context context, cl_mem_flags flags, const host_vector<T>& data, bool zero_copy)
+{
+    // The kernels only read the buffer, so the host memory is not written even in zero-copy mode
+    if (zero_copy)
+        return cl::Buffer(context, flags | CL_MEM_USE_HOST_PTR, sizeof(T) * data.size(), const_cast<T*>(data.data()));
+
+    cl::Buffer buffer(context, flags, sizeof(T) * data.size());
+    queue.enqueueWriteBuffer(buffer, CL_TRUE, 0, sizeof(T) * data.size(), data.data());
+    return buffer;
+}
+
+// Function to create a buffer the kernels write: backed by the host memory of data in zero-copy mode
+template <typename T>
+cl::Buffer create_output_buffer(cl::Context context, cl_mem_flags flags, host_vector<T>& data, bool zero_copy)
+{
+    if (zero_copy)
+        return cl::Buffer(context, flags | CL_MEM_USE_HOST_PTR, sizeof(T) * data.size(), data.data());
+    else
+        return cl::Buffer(context, flags, sizeof(T) * data.size());
+}
+
+// Content of a buffer created by the functions above, readable on the host while this object lives. In zero-copy mode the
+// buffer stays mapped until destruction: the host memory of a CL_MEM_USE_HOST_PTR buffer is only guaranteed to be up to date
+// while it is mapped (the mapped pointer is data.data() itself, nothing is copied on unified memory)
+template <typename T>
+class fetched_buffer
+{
+public:
+    fetched_buffer(cl::CommandQueue queue, cl::Buffer buffer, host_vector<T>& data, bool zero_copy)
+        : queue_(queue), buffer_(buffer), data_(data.data()), size_(data.size())
+    {
+        if (zero_copy)
+        {
+            mapped_ = static_cast<T*>(queue_.enqueueMapBuffer(buffer_, CL_TRUE, CL_MAP_READ, 0, sizeof(T) * size_));
+            data_ = mapped_;
+        }
+        else
+            queue_.enqueueReadBuffer(buffer_, CL_TRUE, 0, sizeof(T) * size_, data_);
+    }
+
+    ~fetched_buffer()
+    {
+        if (mapped_ == nullptr)
+            return;
+
+        // Destructors must not throw, an unmap error is only reported
+        try
+        {
+            queue_.enqueueUnmapMemObject(buffer_, mapped_);
+            queue_.finish();
+        }
+        catch (cl::Error& error)
+        {
+            std::cerr << "Cannot unmap fetched buffer: " << error.what() << "(" << error.err() << ")" << std::endl;
+        }
+    }
+
+    fetched_buffer(const fetched_buffer&) = delete;
+    fetched_buffer& operator=(const fetched_buffer&) = delete;
+
+    const T* data() const { return data_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+
+private:
+    cl::CommandQueue queue_;
+    cl::Buffer buffer_;
+    T* data_;
+    size_t size_;
+    T* mapped_ = nullptr;
+};
+
+// Function to make the content of a buffer created by the functions above readable on the host, see fetched_buffer
+template <typename T>
+fetched_buffer<T> fetch_buffer(cl::CommandQueue queue, cl::Buffer buffer, host_vector<T>& data, bool zero_copy)
+{
+    return fetched_buffer<T>(queue, buffer, data, zero_copy);
+}
+
+// Function to measure the transfer time zero-copy saves: bytes are sent to the device and back
+// with copies (write + read of a device buffer) and with zero-copy (map + unmap of a page-aligned host buffer)
+inline void benchmark_zero_copy_transfers(cl::Context context, cl::CommandQueue queue, size_t bytes, int repetitions = 5)
+{
+    host_vector<char> data(bytes, 1);
+    cl::Buffer buf_copy(context, CL_MEM_READ_WRITE, bytes);
+    cl::Buffer buf_zero_copy(context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, bytes, data.data());
+
+    double best_copy = 0.0, best_zero_copy = 0.0;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        queue.enqueueWriteBuffer(buf_copy, CL_TRUE, 0, bytes, data.data());
+        queue.enqueueReadBuffer(buf_copy, CL_TRUE, 0, bytes, data.data());
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        void* mapped = queue.enqueueMapBuffer(buf_zero_copy, CL_TRUE, CL_MAP_WRITE, 0, bytes);
+        queue.enqueueUnmapMemObject(buf_zero_copy, mapped);
+        mapped = queue.enqueueMapBuffer(buf_zero_copy, CL_TRUE, CL_MAP_READ, 0, bytes);
+        queue.enqueueUnmapMemObject(buf_zero_copy, mapped);
+        queue.finish();
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        double copy = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        double zero_copy = std::chrono::duration<double, std::micro>(t2 - t1).count();
+        if (i == 0 || copy < best_copy)
+            best_copy = copy;
+        if (i == 0 || zero_copy < best_zero_copy)
+            best_zero_copy = zero_copy;
+    }
+
+    std::cout << "Transfer of " << bytes << " bytes to the device and back: copy " << best_copy << " us, zero-copy "
+              << best_zero_copy << " us, saved " << best_copy - best_zero_copy << " us." << std::endl;
+}
@@ -4,16 +4,25 @@ __kernel void conway(read_only image2d_t previous, write_only image2d_t next, sa
     int x = get_global_id(0);
     int y = get_global_id(1);
 
+    // Coordinates of the neighbors, wrapped around the edges of the image (toroidal grid); the wrap is done here
+    // because CL_ADDRESS_REPEAT is only defined for normalized coordinates, the sampler uses CL_ADDRESS_NONE
+    int width = get_image_width(previous);
+    int height = get_image_height(previous);
+    int x_left = (x + width - 1) % width;
+    int x_right = (x + 1) % width;
+    int y_down = (y + height - 1) % height;
+    int y_up = (y + 1) % height;
+
     /// Compute the number of living neighbors
     int4 neighbors[8];
-    neighbors[0] = read_imagei(previous, grid_sampler, (int2)(x, y + 1));
-    neighbors[1] = read_imagei(previous, grid_sampler, (int2)(x, y - 1));
-    neighbors[2] = read_imagei(previous, grid_sampler, (int2)(x + 1, y));
-    neighbors[3] = read_imagei(previous, grid_sampler, (int2)(x - 1, y));
-    neighbors[4] = read_imagei(previous, grid_sampler, (int2)(x - 1, y + 1));
-    neighbors[5] = read_imagei(previous, grid_sampler, (int2)(x - 1, y - 1));
-    neighbors[6] = read_imagei(previous, grid_sampler, (int2)(x + 1, y + 1));
-    neighbors[7] = read_imagei(previous, grid_sampler, (int2)(x + 1, y - 1));
+    neighbors[0] = read_imagei(previous, grid_sampler, (int2)(x, y_up));
+    neighbors[1] = read_imagei(previous, grid_sampler, (int2)(x, y_down));
+    neighbors[2] = read_imagei(previous, grid_sampler, (int2)(x_right, y));
+    neighbors[3] = read_imagei(previous, grid_sampler, (int2)(x_left, y));
+    neighbors[4] = read_imagei(previous, grid_sampler, (int2)(x_left, y_up));
+    neighbors[5] = read_imagei(previous, grid_sampler, (int2)(x_left, y_down));
+    neighbors[6] = read_imagei(previous, grid_sampler, (int2)(x_right, y_up));
+    neighbors[7] = read_imagei(previous, grid_sampler, (int2)(x_right, y_down));
 
     int n_living_neighbors = neighbors[0][0] + neighbors[1][0] + neighbors[2][0] +
                              neighbors[3][0] + neighbors[4][0] + neighbors[5][0] +
@@ -11,13 +11,74 @@
 #include <random>
 #include <chrono>
 #include <numeric>
+#include <array>
+#include <string>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
 
-void dump_state_of_game(char* file_base_name, unsigned int t, size_t N, std::vector<int> state_of_game);
+// POSIX includes for the distributed mode: processes, socket pairs
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
-int main()
+// Shared helpers
+#include "zero_copy.hpp"
+#include "benchmark.hpp"
+
+// Function to dump the state of the game into a csv file, row_pitch is the distance of rows in elements
+void dump_state_of_game(char* file_base_name, unsigned int t, size_t N, const int* state_of_game, size_t row_pitch);
+
+// Function to create the starting state of the game on an N * N grid: random cells or the Gosper glider gun
+std::vector<int> initial_state_of_game(size_t N, bool random_starting_state);
+
+// Function to play the given number of generations on the textures, current is the index of the texture holding the state (updated)
+void play_generations(cl::CommandQueue queue, cl::Kernel kernel, cl::Sampler sampler, std::vector<cl::Image2D>& vec_of_textures,
+                      int& current, unsigned int generations, size_t width, size_t height);
+
+// Function to play T generations of the game in this process on one device, returns the final state
+std::vector<int> play_game_single_process(const std::vector<int>& state_of_game, size_t N, unsigned int T);
+
+// Function to play T generations of the game with the grid split into strips of rows, one strip per process,
+// neighboring strips exchange K rows of halo every K generations, returns the final state gathered from the processes
+std::vector<int> play_game_distributed(const std::vector<int>& state_of_game, size_t N, unsigned int T, size_t n_processes, size_t K);
+
+// Function to play the strip of rows [row_begin, row_begin + rows) in a process of the distributed game, the final strip is written to result_fd
+void play_strip(const std::vector<int>& state_of_game, size_t N, unsigned int T, size_t row_begin, size_t rows, size_t K,
+                int up_fd, int down_fd, int result_fd);
+
+// Function to check that the distributed game ends in the same state as the single process one, bit for bit
+bool check_distributed_game(size_t N, unsigned int T, size_t n_processes, size_t K);
+
+// Functions to send / receive exactly bytes bytes through a socket or pipe
+void write_all(int fd, const void* data, size_t bytes);
+void read_all(int fd, void* data, size_t bytes);
+
+// Function to sweep board sizes and work group sizes of the conway kernel, then print a roofline style summary
+void benchmark_conway(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Kernel kernel);
+
+int main(int argc, char* argv[])
 {
     try
     {
+        /// Distributed mode forks its processes before this one touches OpenCL, so every process initializes its own runtime
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--distributed" && argc >= 3 && argc <= 6)
+        {
+            size_t n_processes = std::stoul(argv[2]);
+            size_t K = argc > 3 ? std::stoul(argv[3]) : 1;
+            size_t N = argc > 4 ? std::stoul(argv[4]) : 64;
+            unsigned int T = argc > 5 ? std::stoul(argv[5]) : 300;
+            return check_distributed_game(N, T, n_processes, K) ? 0 : EXIT_FAILURE;
+        }
+        else if (!mode.empty() && mode != "--benchmark")
+        {
+            std::cerr << "Usage: " << argv[0] << " [--benchmark | --distributed <processes> [halo K = 1] [N = 64] [T = 300]]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
         /// GPU usual inits: queue, device, platform, context
         cl::CommandQueue queue = cl::CommandQueue::getDefault();
         cl::Device device = queue.getInfo<CL_QUEUE_DEVICE>();
@@ -37,6 +98,13 @@ int main()
         /// Create kernel from program
         cl::Kernel kernel(program, "conway");
 
+        /// Benchmark mode works on its own board sizes and does not dump the state of the game
+        if (mode == "--benchmark")
+        {
+            benchmark_conway(context, queue, device, kernel);
+            return 0;
+        }
+
         /// Init N parameter of the game: the game is played on an N * N big square grid
         size_t N = 64;
 
@@ -47,82 +115,28 @@ int main()
         bool random_starting_state = false;
 
         /// Vector holding the state of the game
-        std::vector<int> state_of_game(N * N);
-
-        if (random_starting_state)
-        {
-            /// Create grid with random 0 and 1 values
-            std::random_device rd;                        // Only used once to initialise (seed) engine
-            std::mt19937 rng(rd());                       // Random-number engine used (Mersenne-Twister)
-            std::uniform_int_distribution<int> uni(0, 1); // Uniformly and randomly 0s and 1s 
-
-            for(int i = 0; i < (N * N); ++i)
-                    state_of_game[i] = uni(rng);
-        }
-
-        else
-        {
-            for(int i = 0; i < N*N; ++ i)
-            {
-                // Glider gun
-                if(i == (N + 25)) state_of_game[i] = 1;
-                else if(i == (2*N + 23)) state_of_game[i] = 1;
-                else if(i == (2*N + 25)) state_of_game[i] = 1;
-                else if(i == (3*N + 13)) state_of_game[i] = 1;
-                else if(i == (3*N + 14)) state_of_game[i] = 1;
-                else if(i == (3*N + 21)) state_of_game[i] = 1;
-                else if(i == (3*N + 22)) state_of_game[i] = 1;
-                else if(i == (3*N + 35)) state_of_game[i] = 1;
-                else if(i == (3*N + 36)) state_of_game[i] = 1;
-                else if(i == (4*N + 12)) state_of_game[i] = 1;
-                else if(i == (4*N + 16)) state_of_game[i] = 1;
-                else if(i == (4*N + 21)) state_of_game[i] = 1;
-                else if(i == (4*N + 22)) state_of_game[i] = 1;
-                else if(i == (4*N + 35)) state_of_game[i] = 1;
-                else if(i == (4*N + 36)) state_of_game[i] = 1;
-                else if(i == (5*N + 1)) state_of_game[i] = 1;
-                else if(i == (5*N + 2)) state_of_game[i] = 1;
-                else if(i == (5*N + 11)) state_of_game[i] = 1;
-                else if(i == (5*N + 17)) state_of_game[i] = 1;
-                else if(i == (5*N + 21)) state_of_game[i] = 1;
-                else if(i == (5*N + 22)) state_of_game[i] = 1;
-                else if(i == (6*N + 1)) state_of_game[i] = 1;
-                else if(i == (6*N + 2)) state_of_game[i] = 1;
-                else if(i == (6*N + 11)) state_of_game[i] = 1;
-                else if(i == (6*N + 15)) state_of_game[i] = 1;
-                else if(i == (6*N + 17)) state_of_game[i] = 1;
-                else if(i == (6*N + 18)) state_of_game[i] = 1;
-                else if(i == (6*N + 23)) state_of_game[i] = 1;
-                else if(i == (6*N + 25)) state_of_game[i] = 1;
-                else if(i == (7*N + 11)) state_of_game[i] = 1;
-                else if(i == (7*N + 17)) state_of_game[i] = 1;
-                else if(i == (7*N + 25)) state_of_game[i] = 1;
-                else if(i == (8*N + 12)) state_of_game[i] = 1;
-                else if(i == (8*N + 16)) state_of_game[i] = 1;
-                else if(i == (9*N + 13)) state_of_game[i] = 1;
-                else if(i == (9*N + 14)) state_of_game[i] = 1;
-                
-                // Others are dead
-                else state_of_game[i] = 0;
-            }
-        }
+        std::vector<int> state_of_game = initial_state_of_game(N, random_starting_state);
         
         /// Parameters of the textures to be created
         size_t width = N;
         size_t height = N;
         
+        /// If the device shares memory with the host, textures are allocated in host memory and mapped instead of read
+        bool zero_copy = zero_copy_available(device);
+        cl_mem_flags host_memory_flag = zero_copy ? CL_MEM_ALLOC_HOST_PTR : 0;
+
         /// Create a vector holding the 2 required textures
         std::vector<cl::Image2D> vec_of_textures(2);
-        vec_of_textures[0] = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+        vec_of_textures[0] = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY | CL_MEM_COPY_HOST_PTR | host_memory_flag,
                                          cl::ImageFormat(CL_R, CL_SIGNED_INT32), width, height,
                                          0, state_of_game.data(), nullptr);
 
-        vec_of_textures[1] = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY |CL_MEM_COPY_HOST_PTR,
+        vec_of_textures[1] = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY |CL_MEM_COPY_HOST_PTR | host_memory_flag,
                                          cl::ImageFormat(CL_R, CL_SIGNED_INT32), width, height,
                                          0, state_of_game.data(), nullptr);
 
-        /// Create cl::Sampler
-        cl::Sampler sampler = cl::Sampler(context, CL_FALSE, CL_ADDRESS_REPEAT, CL_FILTER_NEAREST);
+        /// Create cl::Sampler: the kernel wraps the coordinates around the grid itself, they are always inside the image
+        cl::Sampler sampler = cl::Sampler(context, CL_FALSE, CL_ADDRESS_NONE, CL_FILTER_NEAREST);
 
         /// Offset and size arrays for enqueueReadImage()
         const std::array<cl::size_type, 3> origin = {0,0,0};
@@ -131,11 +145,28 @@ int main()
         /// File base name for dumping out the state of the game
         char file_base_name[] = "../csv_outputs/grid"; 
 
+        /// Time spent on getting the state of the game to the host
+        std::chrono::microseconds fetch_time{ 0 };
+
         /// Play the game T times
         for(unsigned int t = 0; t < T; ++t)
         {
             /// Print out the state of the game csv files
-            dump_state_of_game(file_base_name, t, N, state_of_game);
+            if (zero_copy)
+            {
+                /// Map the texture holding the current state, no copy on unified memory
+                auto tStart_fetch = std::chrono::high_resolution_clock::now();
+                size_t row_pitch = 0;
+                int* mapped_state = static_cast<int*>(queue.enqueueMapImage(vec_of_textures[t % 2], CL_TRUE, CL_MAP_READ,
+                                                                            origin, region, &row_pitch, nullptr));
+                fetch_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - tStart_fetch);
+
+                dump_state_of_game(file_base_name, t, N, mapped_state, row_pitch / sizeof(int));
+                queue.enqueueUnmapMemObject(vec_of_textures[t % 2], mapped_state);
+            }
+            else
+                dump_state_of_game(file_base_name, t, N, state_of_game.data(), N);
+
             /// Set kernel arguments
             if (t % 2 == 0)
             {
@@ -153,13 +184,21 @@ int main()
             queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(N,N), cl::NullRange);
             cl::finish();
 
-            /// Read the state of the game
+            /// Read the state of the game (zero-copy mode maps it at the start of the next generation instead)
+            if (zero_copy)
+                continue;
+
+            auto tStart_fetch = std::chrono::high_resolution_clock::now();
             if (t % 2 == 0)
                 queue.enqueueReadImage(vec_of_textures[1], true, origin, region, 0, 0, state_of_game.data(), 0, nullptr);
             else
                 queue.enqueueReadImage(vec_of_textures[0], true, origin, region, 0, 0, state_of_game.data(), 0, nullptr);
+            fetch_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - tStart_fetch);
         }
 
+        std::cout << (zero_copy ? "Zero-copy mode" : "Copy mode") << ": fetching the state of the game took "
+                  << fetch_time.count() << " us in total." << std::endl;
+
     }/// end of try case
     
     catch (cl::BuildError& error) // If kernel failed to build
@@ -183,7 +222,7 @@ int main()
     return 0;
 }/// end of main
 
-void dump_state_of_game(char* file_base_name, unsigned int t, size_t N, std::vector<int> state_of_game)
+void dump_state_of_game(char* file_base_name, unsigned int t, size_t N, const int* state_of_game, size_t row_pitch)
 {
     std::stringstream outpath;
     outpath << file_base_name << t << ".csv";
@@ -194,11 +233,415 @@ void dump_state_of_game(char* file_base_name, unsigned int t, size_t N, std::vec
     {
         for(int j = 0; j < N; ++j)
         {
-            if(state_of_game[i * N + j] == 1) file << "1";
-            else if(state_of_game[i * N + j] == 0) file << "0";
+            if(state_of_game[i * row_pitch + j] == 1) file << "1";
+            else if(state_of_game[i * row_pitch + j] == 0) file << "0";
             if (j < N - 1) file << ",";
         }
         file << "\n";
    }
    file.close();
-}
\ No newline at end of file
+}
+
+std::vector<int> initial_state_of_game(size_t N, bool random_starting_state)
+{
+    /// Vector holding the state of the game
+    std::vector<int> state_of_game(N * N);
+
+    if (random_starting_state)
+    {
+        /// Create grid with random 0 and 1 values
+        std::random_device rd;                        // Only used once to initialise (seed) engine
+        std::mt19937 rng(rd());                       // Random-number engine used (Mersenne-Twister)
+        std::uniform_int_distribution<int> uni(0, 1); // Uniformly and randomly 0s and 1s 
+
+        for(int i = 0; i < (N * N); ++i)
+                state_of_game[i] = uni(rng);
+    }
+
+    else
+    {
+        for(int i = 0; i < N*N; ++ i)
+        {
+            // Glider gun
+            if(i == (N + 25)) state_of_game[i] = 1;
+            else if(i == (2*N + 23)) state_of_game[i] = 1;
+            else if(i == (2*N + 25)) state_of_game[i] = 1;
+            else if(i == (3*N + 13)) state_of_game[i] = 1;
+            else if(i == (3*N + 14)) state_of_game[i] = 1;
+            else if(i == (3*N + 21)) state_of_game[i] = 1;
+            else if(i == (3*N + 22)) state_of_game[i] = 1;
+            else if(i == (3*N + 35)) state_of_game[i] = 1;
+            else if(i == (3*N + 36)) state_of_game[i] = 1;
+            else if(i == (4*N + 12)) state_of_game[i] = 1;
+            else if(i == (4*N + 16)) state_of_game[i] = 1;
+            else if(i == (4*N + 21)) state_of_game[i] = 1;
+            else if(i == (4*N + 22)) state_of_game[i] = 1;
+            else if(i == (4*N + 35)) state_of_game[i] = 1;
+            else if(i == (4*N + 36)) state_of_game[i] = 1;
+            else if(i == (5*N + 1)) state_of_game[i] = 1;
+            else if(i == (5*N + 2)) state_of_game[i] = 1;
+            else if(i == (5*N + 11)) state_of_game[i] = 1;
+            else if(i == (5*N + 17)) state_of_game[i] = 1;
+            else if(i == (5*N + 21)) state_of_game[i] = 1;
+            else if(i == (5*N + 22)) state_of_game[i] = 1;
+            else if(i == (6*N + 1)) state_of_game[i] = 1;
+            else if(i == (6*N + 2)) state_of_game[i] = 1;
+            else if(i == (6*N + 11)) state_of_game[i] = 1;
+            else if(i == (6*N + 15)) state_of_game[i] = 1;
+            else if(i == (6*N + 17)) state_of_game[i] = 1;
+            else if(i == (6*N + 18)) state_of_game[i] = 1;
+            else if(i == (6*N + 23)) state_of_game[i] = 1;
+            else if(i == (6*N + 25)) state_of_game[i] = 1;
+            else if(i == (7*N + 11)) state_of_game[i] = 1;
+            else if(i == (7*N + 17)) state_of_game[i] = 1;
+            else if(i == (7*N + 25)) state_of_game[i] = 1;
+            else if(i == (8*N + 12)) state_of_game[i] = 1;
+            else if(i == (8*N + 16)) state_of_game[i] = 1;
+            else if(i == (9*N + 13)) state_of_game[i] = 1;
+            else if(i == (9*N + 14)) state_of_game[i] = 1;
+            
+            // Others are dead
+            else state_of_game[i] = 0;
+        }
+    }
+
+    return state_of_game;
+}
+
+void benchmark_conway(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Kernel kernel)
+{
+    /// Generations played per measured point
+    const int generations = 10;
+
+    cl::Sampler sampler = cl::Sampler(context, CL_FALSE, CL_ADDRESS_NONE, CL_FILTER_NEAREST);
+    size_t max_work_group_size = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+
+    std::vector<benchmark_point> points;
+
+    for (size_t N = 64; N <= 4096; N *= 4)
+    {
+        /// Random board
+        std::vector<int> state_of_game(N * N);
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> uni(0, 1);
+        for (auto& cell : state_of_game)
+            cell = uni(rng);
+
+        std::vector<cl::Image2D> vec_of_textures(2);
+        for (auto& texture : vec_of_textures)
+            texture = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, cl::ImageFormat(CL_R, CL_SIGNED_INT32),
+                                  N, N, 0, state_of_game.data(), nullptr);
+
+        /// Square work groups, as long as they fit the board and the kernel
+        for (size_t w = 4; w <= 32 && w <= N && w * w <= max_work_group_size; w *= 2)
+        {
+            double seconds = time_best_of(3, [&]()
+            {
+                for (int t = 0; t < generations; ++t)
+                {
+                    kernel.setArg(0, vec_of_textures[t % 2]);
+                    kernel.setArg(1, vec_of_textures[(t + 1) % 2]);
+                    kernel.setArg(2, sampler);
+                    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(N, N), cl::NDRange(w, w));
+                }
+                queue.finish();
+            }) / generations;
+
+            /// Every cell is read and written once per generation (the neighbors come from the cache at best);
+            /// the kernel only does integer work, so it is counted as 0 flops and always sits on the memory roof
+            points.push_back({ "conway", N * N, w * w, seconds, 2.0 * sizeof(int) * N * N, 0.0 });
+            print_benchmark_point(points.back());
+        }
+    }
+
+    finish_benchmark(context, queue, device, points, "benchmark_conway.csv");
+}
+
+void play_generations(cl::CommandQueue queue, cl::Kernel kernel, cl::Sampler sampler, std::vector<cl::Image2D>& vec_of_textures,
+                      int& current, unsigned int generations, size_t width, size_t height)
+{
+    for (unsigned int t = 0; t < generations; ++t)
+    {
+        kernel.setArg(0, vec_of_textures[current]);
+        kernel.setArg(1, vec_of_textures[1 - current]);
+        kernel.setArg(2, sampler);
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
+        current = 1 - current;
+    }
+    queue.finish();
+}
+
+std::vector<int> play_game_single_process(const std::vector<int>& state_of_game, size_t N, unsigned int T)
+{
+    /// GPU usual inits: queue, device, context
+    cl::CommandQueue queue = cl::CommandQueue::getDefault();
+    cl::Device device = queue.getInfo<CL_QUEUE_DEVICE>();
+    cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+
+    cl::Program program{ context, load_kernel_source("../conway.cl") };
+    program.build({ device });
+    cl::Kernel kernel(program, "conway");
+
+    std::vector<int> final_state = state_of_game;
+
+    std::vector<cl::Image2D> vec_of_textures(2);
+    for (auto& texture : vec_of_textures)
+        texture = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, cl::ImageFormat(CL_R, CL_SIGNED_INT32),
+                              N, N, 0, final_state.data(), nullptr);
+    cl::Sampler sampler = cl::Sampler(context, CL_FALSE, CL_ADDRESS_NONE, CL_FILTER_NEAREST);
+
+    int current = 0;
+    play_generations(queue, kernel, sampler, vec_of_textures, current, T, N, N);
+
+    const std::array<cl::size_type, 3> origin = { 0, 0, 0 };
+    const std::array<cl::size_type, 3> region = { N, N, 1 };
+    queue.enqueueReadImage(vec_of_textures[current], CL_TRUE, origin, region, 0, 0, final_state.data());
+
+    return final_state;
+}
+
+std::vector<int> play_game_distributed(const std::vector<int>& state_of_game, size_t N, unsigned int T, size_t n_processes, size_t K)
+{
+    /// Strips of (almost) equal number of rows, the first N % n_processes strips get one more row
+    std::vector<size_t> row_begins(n_processes), rows(n_processes);
+    for (size_t p = 0, row = 0; p < n_processes; row += rows[p], ++p)
+    {
+        row_begins[p] = row;
+        rows[p] = N / n_processes + (p < N % n_processes ? 1 : 0);
+    }
+
+    /// The strips form a ring (the grid is toroidal): socket pair p links the bottom of strip p (end 0) with the top of strip p + 1 (end 1),
+    /// pipe p carries the final strip p back to this process
+    std::vector<std::array<int, 2>> links(n_processes), results(n_processes);
+    for (size_t p = 0; p < n_processes; ++p)
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, links[p].data()) != 0 || pipe(results[p].data()) != 0)
+            throw std::runtime_error{ std::string{ "Cannot create socket pair or pipe: " } + std::strerror(errno) };
+
+    std::vector<pid_t> pids(n_processes);
+    for (size_t p = 0; p < n_processes; ++p)
+    {
+        int up_fd = links[(p + n_processes - 1) % n_processes][1];
+        int down_fd = links[p][0];
+        int result_fd = results[p][1];
+
+        pids[p] = fork();
+        if (pids[p] < 0)
+            throw std::runtime_error{ std::string{ "Cannot fork: " } + std::strerror(errno) };
+
+        if (pids[p] == 0)
+        {
+            /// Keep only the own ends open, so the neighbors see the end of the stream if this process dies
+            for (size_t q = 0; q < n_processes; ++q)
+                for (int fd : { links[q][0], links[q][1], results[q][0], results[q][1] })
+                    if (fd != up_fd && fd != down_fd && fd != result_fd)
+                        close(fd);
+
+            int status = EXIT_SUCCESS;
+            try
+            {
+                play_strip(state_of_game, N, T, row_begins[p], rows[p], K, up_fd, down_fd, result_fd);
+            }
+            catch (cl::Error& error)
+            {
+                std::cerr << "Process " << p << ": " << error.what() << "(" << error.err() << ")" << std::endl;
+                status = EXIT_FAILURE;
+            }
+            catch (std::exception& error)
+            {
+                std::cerr << "Process " << p << ": " << error.what() << std::endl;
+                status = EXIT_FAILURE;
+            }
+
+            /// Leave without running the destructors and exit handlers of the state copied from the parent
+            _exit(status);
+        }
+    }
+
+    for (size_t p = 0; p < n_processes; ++p)
+    {
+        close(links[p][0]);
+        close(links[p][1]);
+        close(results[p][1]);
+    }
+
+    /// Gather the final strips, then wait for every process
+    std::vector<int> final_state(N * N);
+    bool failed = false;
+    for (size_t p = 0; p < n_processes; ++p)
+    {
+        try
+        {
+            read_all(results[p][0], final_state.data() + row_begins[p] * N, sizeof(int) * rows[p] * N);
+        }
+        catch (std::exception&)
+        {
+            failed = true;
+        }
+        close(results[p][0]);
+    }
+
+    for (size_t p = 0; p < n_processes; ++p)
+    {
+        int status = 0;
+        if (waitpid(pids[p], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            failed = true;
+    }
+
+    if (failed)
+        throw std::runtime_error{ "A process of the distributed game failed" };
+
+    return final_state;
+}
+
+void play_strip(const std::vector<int>& state_of_game, size_t N, unsigned int T, size_t row_begin, size_t rows, size_t K,
+                int up_fd, int down_fd, int result_fd)
+{
+    /// Every process has its own runtime, queue, device, context
+    cl::CommandQueue queue = cl::CommandQueue::getDefault();
+    cl::Device device = queue.getInfo<CL_QUEUE_DEVICE>();
+    cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+
+    cl::Program program{ context, load_kernel_source("../conway.cl") };
+    program.build({ device });
+    cl::Kernel kernel(program, "conway");
+
+    /// The strip is stored with K rows of halo above and below it: the rows of the neighboring strips, wrapped around the grid
+    size_t height = rows + 2 * K;
+    std::vector<int> strip(height * N);
+    for (size_t r = 0; r < height; ++r)
+    {
+        size_t grid_row = (row_begin + N - K + r) % N;
+        std::copy_n(state_of_game.begin() + grid_row * N, N, strip.begin() + r * N);
+    }
+
+    std::vector<cl::Image2D> vec_of_textures(2);
+    for (auto& texture : vec_of_textures)
+        texture = cl::Image2D(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, cl::ImageFormat(CL_R, CL_SIGNED_INT32),
+                              N, height, 0, strip.data(), nullptr);
+    cl::Sampler sampler = cl::Sampler(context, CL_FALSE, CL_ADDRESS_NONE, CL_FILTER_NEAREST);
+
+    /// Regions of the texture: the halos and the K rows at the edges of the strip the neighbors need as their halos
+    const std::array<cl::size_type, 3> halo_region = { N, K, 1 };
+    const std::array<cl::size_type, 3> top_halo = { 0, 0, 0 };
+    const std::array<cl::size_type, 3> top_rows = { 0, K, 0 };
+    const std::array<cl::size_type, 3> bottom_rows = { 0, rows, 0 };
+    const std::array<cl::size_type, 3> bottom_halo = { 0, rows + K, 0 };
+
+    std::vector<int> send_up(K * N), send_down(K * N), receive_up(K * N), receive_down(K * N);
+    size_t halo_bytes = sizeof(int) * K * N;
+
+    /// A generation spoils one more row at both ends of the texture (the kernel wraps around it, not around the grid),
+    /// so after K generations the halos are used up and the strip itself is still right: time to exchange them
+    int current = 0;
+    for (unsigned int t = 0; t < T; )
+    {
+        unsigned int generations = std::min<unsigned int>(K, T - t);
+        play_generations(queue, kernel, sampler, vec_of_textures, current, generations, N, height);
+        t += generations;
+        if (t == T)
+            break;
+
+        queue.enqueueReadImage(vec_of_textures[current], CL_TRUE, top_rows, halo_region, 0, 0, send_up.data());
+        queue.enqueueReadImage(vec_of_textures[current], CL_TRUE, bottom_rows, halo_region, 0, 0, send_down.data());
+
+        /// Send on a thread of its own, so no process blocks on a full socket while its neighbor is sending as well
+        std::exception_ptr send_error, receive_error;
+        std::thread sender([&]()
+        {
+            try
+            {
+                write_all(up_fd, send_up.data(), halo_bytes);
+                write_all(down_fd, send_down.data(), halo_bytes);
+            }
+            catch (...) { send_error = std::current_exception(); }
+        });
+
+        try
+        {
+            read_all(up_fd, receive_up.data(), halo_bytes);
+            read_all(down_fd, receive_down.data(), halo_bytes);
+        }
+        catch (...) { receive_error = std::current_exception(); }
+
+        sender.join();
+        if (send_error)
+            std::rethrow_exception(send_error);
+        if (receive_error)
+            std::rethrow_exception(receive_error);
+
+        queue.enqueueWriteImage(vec_of_textures[current], CL_TRUE, top_halo, halo_region, 0, 0, receive_up.data());
+        queue.enqueueWriteImage(vec_of_textures[current], CL_TRUE, bottom_halo, halo_region, 0, 0, receive_down.data());
+    }
+
+    /// Send the strip without its halos back
+    std::vector<int> final_strip(rows * N);
+    const std::array<cl::size_type, 3> strip_region = { N, rows, 1 };
+    queue.enqueueReadImage(vec_of_textures[current], CL_TRUE, top_rows, strip_region, 0, 0, final_strip.data());
+    write_all(result_fd, final_strip.data(), sizeof(int) * final_strip.size());
+}
+
+bool check_distributed_game(size_t N, unsigned int T, size_t n_processes, size_t K)
+{
+    if (n_processes < 2 || K < 1 || N / n_processes < K)
+        throw std::runtime_error{ "Distributed mode needs at least 2 processes and strips of at least K rows (K >= 1)" };
+
+    /// Random starting state, the forked processes get a copy of it
+    std::vector<int> state_of_game = initial_state_of_game(N, true);
+
+    /// The distributed game runs first: the processes have to be forked before this one initializes OpenCL
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<int> distributed_state = play_game_distributed(state_of_game, N, T, n_processes, K);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<int> single_process_state = play_game_single_process(state_of_game, N, T);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Distributed game: " << n_processes << " processes, halo of " << K << " rows exchanged every " << K
+              << " generations, " << N << " x " << N << " grid, " << T << " generations" << std::endl;
+    std::cout << "\tdistributed: " << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, single process: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us" << std::endl;
+
+    bool same = std::equal(distributed_state.begin(), distributed_state.end(), single_process_state.begin());
+    if (same)
+        std::cout << "\tOK: the distributed game ends in the same state as the single process one." << std::endl;
+    else
+    {
+        size_t differing_cells = 0;
+        for (size_t i = 0; i < N * N; ++i)
+            differing_cells += distributed_state[i] != single_process_state[i] ? 1 : 0;
+        std::cout << "\tWRONG: " << differing_cells << " cells differ from the single process game." << std::endl;
+    }
+
+    return same;
+}
+
+void write_all(int fd, const void* data, size_t bytes)
+{
+    const char* next = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t written = write(fd, next, bytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw std::runtime_error{ std::string{ "Cannot send to the other process: " } + std::strerror(errno) };
+        next += written;
+        bytes -= written;
+    }
+}
+
+void read_all(int fd, void* data, size_t bytes)
+{
+    char* next = static_cast<char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t received = read(fd, next, bytes);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0)
+            throw std::runtime_error{ std::string{ "Cannot receive from the other process: " } + std::strerror(errno) };
+        if (received == 0)
+            throw std::runtime_error{ "The other process closed the connection" };
+        next += received;
+        bytes -= received;
+    }
+}
@@ -11,6 +11,21 @@
 #include <random>
 #include <chrono>
 #include <numeric>
+#include <string>
+#include <cmath>
+
+// Shared helpers
+#include "zero_copy.hpp"
+#include "multi_device.hpp"
+#include "benchmark.hpp"
+
+// Count, sum and sum of squared differences from the mean (M2) of a part of the data
+struct partial_moments
+{
+    double count;
+    double sum;
+    double M2;
+};
 
 // Function to determine how many kernel launches will be needed based on the size of input data
 int number_of_kernel_launches(size_t N, size_t workGroupSize, bool logging);
@@ -33,15 +48,39 @@ float compute_mean_or_var_via_gpu(std::vector<cl::Buffer> vec_of_bufs, int n_lau
 void print_results(float mean, float var, bool gpu_results);
 
 // Function to compute mean on CPU for reference calculation
-float compute_mean_cpu(std::vector<float> data_original, int N_original);
+float compute_mean_cpu(const host_vector<float>& data_original, int N_original);
 
 // Function to compute mean on CPU for reference calculation
-float compute_var_cpu(std::vector<float> data_original, int N_original, float mean_CPU);
+float compute_var_cpu(const host_vector<float>& data_original, int N_original, float mean_CPU);
+
+// Function to compare CPU and GPU results, check if they are within epsilon tolerated range: the error of the mean is relative to
+// |mean| + mean_scale, the magnitude of the summed values (the mean itself may cancel out to ~0, e.g. for adjacent differences)
+void compare_cpu_gpu_results(float mean_CPU, float mean_GPU, float var_CPU, float var_GPU, float tolerance, float mean_scale = 0.0f);
+
+// Function to compute the partial moments of n values with the mean and var reduction chains on one device
+partial_moments compute_partial_moments_via_gpu(const float* data, size_t n, cl::Device device, cl::Context context, cl::CommandQueue queue,
+                                                cl::Kernel kernel_mean, cl::Kernel kernel_var);
+
+// Function to merge partial moments of two disjoint parts of the data (Chan et al.)
+partial_moments merge_partial_moments(partial_moments a, partial_moments b);
+
+// Function to split the data across every device in proportion to their throughput and merge the partial moments on the host
+void compute_mean_and_var_via_multiple_devices(const host_vector<float>& data, const std::string& source_mean, const std::string& source_var,
+                                               unsigned int sub_devices_per_cpu, float& mean, float& var);
+
+// Function to split a comma separated list of transform stages, e.g. "adjacent_difference,square"
+std::vector<std::string> parse_transform_stages(const std::string& list);
+
+// Function to generate the OpenCL source of transform(): the stages applied one after the other to the data at an index
+std::string generate_transform_source(const std::vector<std::string>& stages);
+
+// Function to apply the transform stages to the data on CPU for reference calculation
+host_vector<float> apply_transform_stages_cpu(const host_vector<float>& data, const std::vector<std::string>& stages);
 
-// Function to compare CPU and GPU results, check if they are within epsilon tolerated range
-void compare_cpu_gpu_results(float mean_CPU, float mean_GPU, float var_CPU, float var_GPU, float tolerance);
+// Function to sweep problem sizes and work group sizes of the mean and var reduction chains, then print a roofline style summary
+void benchmark_mean_var(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program_mean, cl::Program program_var);
 
-int main()
+int main(int argc, char* argv[])
 {
     try
     {
@@ -60,27 +99,76 @@ int main()
             throw std::runtime_error{ std::string{ "Cannot open kernel source: " } + "var_reduction.cl" };
     
         // Create cl::Program from kernels and build them for the device
-        cl::Program program_mean{ std::string{ std::istreambuf_iterator<char>{ source_file_mean },
-                                  std::istreambuf_iterator<char>{} } };
-        cl::Program program_var{ std::string{ std::istreambuf_iterator<char>{ source_file_var },
-                                 std::istreambuf_iterator<char>{} } };
+        std::string source_mean{ std::istreambuf_iterator<char>{ source_file_mean }, std::istreambuf_iterator<char>{} };
+        std::string source_var{ std::istreambuf_iterator<char>{ source_file_var }, std::istreambuf_iterator<char>{} };
+        cl::Program program_mean{ source_mean };
+        cl::Program program_var{ source_var };
 
         program_mean.build({ device });
         program_var.build({ device });
 
+        // Benchmark mode works on its own data sizes
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--benchmark")
+        {
+            benchmark_mean_var(context, queue, device, program_mean, program_var);
+            return 0;
+        }
+
         // Create input data vector and fill with random numbers
         size_t N = 512*512*512 + 1;
-        std::vector<float> data(N);
+        host_vector<float> data(N);
 
         auto prng = [engine = std::default_random_engine{},
                      distribution = std::uniform_real_distribution<cl_float>{ 0.0, 100.0 }]() mutable { return distribution(engine); };
 
         std::generate_n(std::begin(data), N, prng);
 
+        // Multi-device mode: every device of the host reduces its own part of the data
+        if (mode == "--multi-device")
+        {
+            unsigned int sub_devices_per_cpu = (argc > 2) ? std::stoul(argv[2]) : 0;
+
+            float multi_device_mean = 0.0, multi_device_var = 0.0;
+            compute_mean_and_var_via_multiple_devices(data, source_mean, source_var, sub_devices_per_cpu, multi_device_mean, multi_device_var);
+            print_results(multi_device_mean, multi_device_var, true);
+
+            float cpu_mean = compute_mean_cpu(data, N);
+            float cpu_var = compute_var_cpu(data, N, cpu_mean);
+            print_results(cpu_mean, cpu_var, false);
+
+            float tolerance = 1e-6;
+            compare_cpu_gpu_results(cpu_mean, multi_device_mean, cpu_var, multi_device_var, tolerance);
+            return 0;
+        }
+        else if (!mode.empty() && !(mode == "--fused" && argc <= 3))
+        {
+            std::cerr << "Usage: " << argv[0] << " [--multi-device [sub-devices per CPU device] | --benchmark | "
+                      << "--fused [stages = adjacent_difference,square, any of adjacent_difference, abs, square]]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
         // Create kernels from programs
         cl::Kernel kernel_mean(program_mean, "mean_reduction");
         cl::Kernel kernel_var(program_var, "var_reduction");
 
+        // Fused mode: mean and var of the data transformed by the stages, the generated transform() is prepended to the reduction
+        // kernels and applied by their first launch while loading the data, so no intermediate array is written
+        std::vector<std::string> transform_stages;
+        if (mode == "--fused")
+        {
+            transform_stages = parse_transform_stages(argc > 2 ? argv[2] : "adjacent_difference,square");
+
+            std::string source_transform = generate_transform_source(transform_stages);
+            cl::Program program_fused_mean{ source_transform + source_mean };
+            cl::Program program_fused_var{ source_transform + source_var };
+            program_fused_mean.build({ device });
+            program_fused_var.build({ device });
+
+            kernel_mean = cl::Kernel(program_fused_mean, "mean_reduction");
+            kernel_var = cl::Kernel(program_fused_var, "var_reduction");
+        }
+
         // Access work group size 
         size_t workGroupSize = kernel_mean.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
         
@@ -93,8 +181,16 @@ int main()
         // Determine buffer sizes
         std::vector<size_t>  buf_sizes = determine_buffer_sizes(N, workGroupSize, true);
 
+        // If the device shares memory with the host, the input buffer uses data directly instead of a copy
+        bool zero_copy = zero_copy_available(device);
+        std::cout << "LOG: " << (zero_copy ? "zero-copy mode, device shares memory with the host" : "copy mode, device has its own memory") << std::endl;
+
         // Construct the buffers
-        vec_of_bufs[0] = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_NO_ACCESS | CL_MEM_COPY_HOST_PTR, sizeof(float) * buf_sizes[0], data.data());
+        auto tStart_dispatch = std::chrono::high_resolution_clock::now();
+        vec_of_bufs[0] = create_input_buffer(queue, context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, data, zero_copy);
+        auto tEnd_dispatch = std::chrono::high_resolution_clock::now();
+        std::cout << "LOG: dispatch of the input data took "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(tEnd_dispatch - tStart_dispatch).count() << " us" << std::endl;
         vec_of_bufs[1] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[1], nullptr);
         vec_of_bufs[2] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[2], nullptr);
 
@@ -113,16 +209,25 @@ int main()
         // Print out GPU results
         print_results(gpu_mean, gpu_var, true);
 
-        // Perform mean and var CPU reference calculations
-        float cpu_mean = compute_mean_cpu(data, N);
-        float cpu_var = compute_var_cpu(data, N, cpu_mean);
+        // Perform mean and var CPU reference calculations (on the transformed data in fused mode)
+        host_vector<float> transformed_data;
+        if (!transform_stages.empty())
+            transformed_data = apply_transform_stages_cpu(data, transform_stages);
+        const host_vector<float>& cpu_data = transform_stages.empty() ? data : transformed_data;
+
+        float cpu_mean = compute_mean_cpu(cpu_data, N);
+        float cpu_var = compute_var_cpu(cpu_data, N, cpu_mean);
         
         // Print out CPU results
         print_results(cpu_mean, cpu_var, false);
 
-        // Check if mean and var computed by GPU and CPU are the same within small tolerance
+        // Check if mean and var computed by GPU and CPU are the same within small tolerance; in fused mode the error of the mean
+        // is also scaled by the mean magnitude of the transformed values, as their mean may cancel out (adjacent differences telescope)
         float tolerance = 1e-6;
-        compare_cpu_gpu_results(cpu_mean, gpu_mean, cpu_var, gpu_var, tolerance);
+        float mean_scale = 0.0f;
+        if (!transform_stages.empty())
+            mean_scale = std::accumulate(cpu_data.begin(), cpu_data.end(), 0.0, [](double sum, float v) { return sum + std::abs(v); }) / N;
+        compare_cpu_gpu_results(cpu_mean, gpu_mean, cpu_var, gpu_var, tolerance, mean_scale);
 
     }/// end of try case
     
@@ -282,7 +387,7 @@ float compute_mean_or_var_via_gpu(std::vector<cl::Buffer> vec_of_bufs, int n_lau
     if (meanTrue_varFalse == false)
         kernel.setArg(7, gpu_mean);                           // float mean
     queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global_work_sizes[0]), cl::NDRange(workGroupSize));
-    cl::finish();
+    queue.finish();
 
     // Other kernel launches
     for(int iLaunch = 1; iLaunch < n_launch; ++iLaunch)
@@ -307,7 +412,7 @@ float compute_mean_or_var_via_gpu(std::vector<cl::Buffer> vec_of_bufs, int n_lau
         if (meanTrue_varFalse == false)
             kernel.setArg(7, gpu_mean);                           // float mean
         queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global_work_sizes[iLaunch]), cl::NDRange(workGroupSize));
-        cl::finish();
+        queue.finish();
     }
     // Read out the sample mean computed by GPU
     if (n_launch == 1 || n_launch % 2 == 1)
@@ -336,14 +441,14 @@ void print_results(float mean, float var, bool gpu_results)
     }
 }
 
-float compute_mean_cpu(std::vector<float> data_original, int N_original)
+float compute_mean_cpu(const host_vector<float>& data_original, int N_original)
 {
     float sum_CPU = std::accumulate(data_original.begin(), data_original.end(), 0.0);
     float mean_CPU = sum_CPU / N_original;
     return mean_CPU;
 }
 
-float compute_var_cpu(std::vector<float> data_original, int N_original, float mean_CPU)
+float compute_var_cpu(const host_vector<float>& data_original, int N_original, float mean_CPU)
 {
     std::vector<float> var_data(N_original);
     for(int i = 0; i < N_original; ++i)
@@ -354,9 +459,9 @@ float compute_var_cpu(std::vector<float> data_original, int N_original, float me
     return var_CPU;
 }
 
-void compare_cpu_gpu_results(float mean_CPU, float mean_GPU, float var_CPU, float var_GPU, float tolerance)
+void compare_cpu_gpu_results(float mean_CPU, float mean_GPU, float var_CPU, float var_GPU, float tolerance, float mean_scale)
 {
-    float relative_error_mean = std::abs((mean_CPU - mean_GPU) / mean_CPU);
+    float relative_error_mean = std::abs(mean_CPU - mean_GPU) / (std::abs(mean_CPU) + mean_scale);
     float relative_error_var = std::abs((var_CPU - var_GPU) / var_CPU);
 
     std::cout << "###############################" << std::endl;
@@ -373,4 +478,232 @@ void compare_cpu_gpu_results(float mean_CPU, float mean_GPU, float var_CPU, floa
     else
         std::cout << "Var calculation WRONG!" << std::endl;
     std::cout << "###############################\n" << std::endl;
-}
\ No newline at end of file
+}
+
+partial_moments compute_partial_moments_via_gpu(const float* data, size_t n, cl::Device device, cl::Context context, cl::CommandQueue queue,
+                                                cl::Kernel kernel_mean, cl::Kernel kernel_var)
+{
+    // Nothing to reduce for too small parts
+    if (n == 0)
+        return { 0.0, 0.0, 0.0 };
+    if (n == 1)
+        return { 1.0, data[0], 0.0 };
+
+    // Same reduction chain as the single device computation, sized for this part of the data
+    size_t workGroupSize = kernel_mean.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    int n_launch = number_of_kernel_launches(n, workGroupSize, false);
+    std::vector<size_t> buf_sizes = determine_buffer_sizes(n, workGroupSize, false);
+    std::vector<size_t> global_work_sizes = determine_global_work_sizes(n_launch, n, workGroupSize, false);
+    std::vector<size_t> data_sizes_to_reduce = determine_data_sizes_to_reduce(n_launch, n, workGroupSize, false);
+
+    // Zero-copy on devices sharing memory with the host (e.g. CPU sub-devices), as long as the part starts on a page
+    bool zero_copy = zero_copy_available(device, data);
+
+    std::vector<cl::Buffer> vec_of_bufs(3);
+    vec_of_bufs[0] = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_NO_ACCESS | (zero_copy ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR),
+                                sizeof(float) * buf_sizes[0], const_cast<float*>(data));
+    vec_of_bufs[1] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[1], nullptr);
+    vec_of_bufs[2] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[2], nullptr);
+
+    float mean = compute_mean_or_var_via_gpu(vec_of_bufs, n_launch, n, workGroupSize, data_sizes_to_reduce, global_work_sizes, kernel_mean, queue, true, 0.0);
+    float var = compute_mean_or_var_via_gpu(vec_of_bufs, n_launch, n, workGroupSize, data_sizes_to_reduce, global_work_sizes, kernel_var, queue, false, mean);
+
+    // Sample variance was divided by n - 1
+    return { static_cast<double>(n), static_cast<double>(mean) * n, static_cast<double>(var) * (n - 1) };
+}
+
+partial_moments merge_partial_moments(partial_moments a, partial_moments b)
+{
+    if (a.count == 0)
+        return b;
+    if (b.count == 0)
+        return a;
+
+    double count = a.count + b.count;
+    double delta = b.sum / b.count - a.sum / a.count;
+    return { count, a.sum + b.sum, a.M2 + b.M2 + delta * delta * a.count * b.count / count };
+}
+
+void compute_mean_and_var_via_multiple_devices(const host_vector<float>& data, const std::string& source_mean, const std::string& source_var,
+                                               unsigned int sub_devices_per_cpu, float& mean, float& var)
+{
+    std::vector<device_context> devices = select_all_devices(sub_devices_per_cpu);
+    size_t n_devices = devices.size();
+
+    // Build the kernels for every device
+    std::vector<cl::Kernel> kernels_mean(n_devices), kernels_var(n_devices);
+    for (size_t i = 0; i < n_devices; ++i)
+    {
+        cl::Program program_mean{ devices[i].context, source_mean };
+        cl::Program program_var{ devices[i].context, source_var };
+        program_mean.build({ devices[i].device });
+        program_var.build({ devices[i].device });
+        kernels_mean[i] = cl::Kernel(program_mean, "mean_reduction");
+        kernels_var[i] = cl::Kernel(program_var, "var_reduction");
+    }
+
+    // Throughput of every device on the first values of the data
+    size_t probe_size = std::min<size_t>(data.size(), 1 << 22);
+    std::vector<double> throughputs = measure_throughputs(n_devices, probe_size, [&](size_t i, size_t n)
+    {
+        compute_partial_moments_via_gpu(data.data(), n, devices[i].device, devices[i].context, devices[i].queue, kernels_mean[i], kernels_var[i]);
+    });
+
+    // Split the data in proportion to the throughputs, every part starting on a page so zero-copy devices can use it in place
+    std::vector<size_t> counts = align_split(split_by_throughput(data.size(), throughputs), zero_copy_alignment / sizeof(float));
+    std::vector<size_t> offsets(n_devices, 0);
+    for (size_t i = 1; i < n_devices; ++i)
+        offsets[i] = offsets[i - 1] + counts[i - 1];
+
+    std::cout << "LOG: multi-device split of N = " << data.size() << std::endl;
+    for (size_t i = 0; i < n_devices; ++i)
+        std::cout << "\t device " << i << " (" << devices[i].name << "): " << throughputs[i] / 1e6 << " M values/s, " << counts[i] << " values"
+                  << (zero_copy_available(devices[i].device) ? ", zero-copy" : "") << std::endl;
+
+    // Every device runs its own reduction chain on its part
+    std::vector<partial_moments> partials(n_devices);
+    auto tStart = std::chrono::high_resolution_clock::now();
+    run_on_all_devices(n_devices, [&](size_t i)
+    {
+        partials[i] = compute_partial_moments_via_gpu(data.data() + offsets[i], counts[i], devices[i].device, devices[i].context,
+                                                      devices[i].queue, kernels_mean[i], kernels_var[i]);
+    });
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    std::cout << "LOG: multi-device computation time: " << std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tStart).count() << " us" << std::endl;
+
+    // Merge the partial results on the host
+    partial_moments total = { 0.0, 0.0, 0.0 };
+    for (const auto& partial : partials)
+        total = merge_partial_moments(total, partial);
+
+    mean = static_cast<float>(total.sum / total.count);
+    var = static_cast<float>(total.M2 / (total.count - 1));
+}
+
+std::vector<std::string> parse_transform_stages(const std::string& list)
+{
+    std::vector<std::string> stages;
+    std::stringstream stream(list);
+    std::string stage;
+    while (std::getline(stream, stage, ','))
+        if (!stage.empty())
+            stages.push_back(stage);
+
+    if (stages.empty())
+        throw std::runtime_error{ "No transform stage given" };
+    return stages;
+}
+
+std::string generate_transform_source(const std::vector<std::string>& stages)
+{
+    // Every adjacent_difference stage needs one more value in front of i, so transform() loads the window of the
+    // D + 1 values ending at i once (D: number of adjacent_difference stages) and applies the stages to the window in place:
+    // every stage evaluates its predecessor once per element of the window
+    size_t D = std::count(stages.begin(), stages.end(), std::string{ "adjacent_difference" });
+
+    std::stringstream source;
+    source << "#define TRANSFORM_DEFINED\n";
+    source << "float transform(__global const float* data, size_t i)\n{\n";
+    source << "    float w[" << D + 1 << "];\n";
+    source << "    for (int j = 0; j <= " << D << "; ++j)\n";
+    source << "        w[j] = (i + j >= " << D << ") ? data[i + j - " << D << "] : 0.0f;\n";
+
+    // Window position j holds the value at index i + j - D, an adjacent_difference stage moves the first valid position by one
+    size_t first = 0;
+    for (const auto& stage : stages)
+    {
+        source << "    // " << stage << "\n";
+        if (stage == "adjacent_difference")
+        {
+            // Backwards, so w[j - 1] still holds the previous stage; the first element is kept as is,
+            // like in the adjacent_difference kernels
+            source << "    for (int j = " << D << "; j > " << first << "; --j)\n";
+            source << "        w[j] = (i + j > " << D << ") ? w[j] - w[j - 1] : w[j];\n";
+            ++first;
+        }
+        else if (stage == "abs")
+        {
+            source << "    for (int j = " << first << "; j <= " << D << "; ++j)\n";
+            source << "        w[j] = fabs(w[j]);\n";
+        }
+        else if (stage == "square")
+        {
+            source << "    for (int j = " << first << "; j <= " << D << "; ++j)\n";
+            source << "        w[j] = w[j] * w[j];\n";
+        }
+        else
+            throw std::runtime_error{ "Unknown transform stage: " + stage + " (stages: adjacent_difference, abs, square)" };
+    }
+
+    source << "    return w[" << D << "];\n}\n";
+    return source.str();
+}
+
+host_vector<float> apply_transform_stages_cpu(const host_vector<float>& data, const std::vector<std::string>& stages)
+{
+    host_vector<float> transformed = data;
+    for (const auto& stage : stages)
+    {
+        if (stage == "adjacent_difference")
+            std::adjacent_difference(transformed.begin(), transformed.end(), transformed.begin());
+        else if (stage == "abs")
+            std::transform(transformed.begin(), transformed.end(), transformed.begin(), [](float v) { return std::fabs(v); });
+        else if (stage == "square")
+            std::transform(transformed.begin(), transformed.end(), transformed.begin(), [](float v) { return v * v; });
+        else
+            throw std::runtime_error{ "Unknown transform stage: " + stage };
+    }
+    return transformed;
+}
+
+void benchmark_mean_var(cl::Context context, cl::CommandQueue queue, cl::Device device, cl::Program program_mean, cl::Program program_var)
+{
+    cl::Kernel kernel_mean(program_mean, "mean_reduction");
+    cl::Kernel kernel_var(program_var, "var_reduction");
+
+    std::vector<benchmark_point> points;
+
+    // Problem sizes from 64K to 256M values, as long as the device can allocate them
+    for (size_t N = 1 << 16; N <= (1 << 28); N *= 4)
+    {
+        if (sizeof(float) * N > device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>())
+            break;
+
+        cl::Buffer buf_data(context, CL_MEM_READ_ONLY, sizeof(float) * N);
+        queue.enqueueFillBuffer(buf_data, 1.0f, 0, sizeof(float) * N);
+
+        // The tree reduction of the kernels needs power of two work group sizes
+        for (size_t workGroupSize : sweep_work_group_sizes(kernel_mean, device, kernel_var.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device)))
+        {
+            int n_launch = number_of_kernel_launches(N, workGroupSize, false);
+            std::vector<size_t> buf_sizes = determine_buffer_sizes(N, workGroupSize, false);
+            std::vector<size_t> global_work_sizes = determine_global_work_sizes(n_launch, N, workGroupSize, false);
+            std::vector<size_t> data_sizes_to_reduce = determine_data_sizes_to_reduce(n_launch, N, workGroupSize, false);
+
+            std::vector<cl::Buffer> vec_of_bufs(3);
+            vec_of_bufs[0] = buf_data;
+            vec_of_bufs[1] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[1], nullptr);
+            vec_of_bufs[2] = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, sizeof(float) * buf_sizes[2], nullptr);
+
+            // Every launch of the chain reads its values once
+            double bytes = sizeof(float) * std::accumulate(data_sizes_to_reduce.begin(), data_sizes_to_reduce.end(), 0.0);
+
+            double seconds_mean = time_best_of(5, [&]()
+            {
+                compute_mean_or_var_via_gpu(vec_of_bufs, n_launch, N, workGroupSize, data_sizes_to_reduce, global_work_sizes, kernel_mean, queue, true, 0.0);
+            });
+            points.push_back({ "mean_reduction", N, workGroupSize, seconds_mean, bytes, static_cast<double>(N) });
+            print_benchmark_point(points.back());
+
+            // Variance does a subtraction, a multiplication and an addition per value
+            double seconds_var = time_best_of(5, [&]()
+            {
+                compute_mean_or_var_via_gpu(vec_of_bufs, n_launch, N, workGroupSize, data_sizes_to_reduce, global_work_sizes, kernel_var, queue, false, 1.0);
+            });
+            points.push_back({ "var_reduction", N, workGroupSize, seconds_var, bytes, 3.0 * N });
+            print_benchmark_point(points.back());
+        }
+    }
+
+    finish_benchmark(context, queue, device, points, "benchmark_mean_var.csv");
+}
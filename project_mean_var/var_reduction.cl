@@ -1,3 +1,12 @@
+// Transform of the data applied by the first kernel launch: the host prepends a generated one in fused mode
+// (see generate_transform_source in mean_var.cpp), identity otherwise
+#ifndef TRANSFORM_DEFINED
+float transform(__global const float* data, size_t i)
+{
+    return data[i];
+}
+#endif
+
 __kernel void var_reduction(__global float* data, __local float* localData, __global float* result, int iLaunch, int lastLaunchIndex, size_t N, size_t numOfValues, float mean)
 {
     int gid = get_global_id(0);        // id of the work item amongs every work items 
@@ -7,9 +16,12 @@ __kernel void var_reduction(__global float* data, __local float* localData, __gl
     // transfer from global to local memory
     // zero pad first
     localData[lid] = 0;
-    // then if we have a valid value, copy it variance wise if it's the first kernel launch
+    // then if we have a valid value, copy it transformed and variance wise if it's the first kernel launch
     if (gid < numOfValues && iLaunch == 0)
-        localData[lid] = ((data[gid] - mean) * (data[gid] - mean));
+    {
+        float value = transform(data, gid);
+        localData[lid] = ((value - mean) * (value - mean));
+    }
     // or normally, if we are after the first kernel launch
     else if (gid < numOfValues && iLaunch > 0)
         localData[lid] = data[gid];